@@ -21,72 +21,168 @@
 #include <avahi-client/lookup.h>
 #include <avahi-client/publish.h>
 #include <avahi-common/error.h>
-#include <avahi-common/simple-watch.h>
+#include <avahi-common/thread-watch.h>
+#include <avahi-common/timeval.h>
 
 #include <net/if.h>
 #include <stdexcept>
 
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
 
 using ScopedLock = std::unique_lock<std::mutex>;
 namespace chrono = std::chrono;
 
 #define WARN std::cerr << __FILE__ << ":" << __LINE__ << ": "
 
-// http://stackoverflow.com/questions/14430906
-//   Proper way of doing this is using the threaded polling in avahi
-namespace
-{
-static std::mutex _mutex;
-
-int64_t _elapsedMilliseconds(
-    const chrono::high_resolution_clock::time_point& startTime)
-{
-    const chrono::high_resolution_clock::time_point& endTime =
-        chrono::high_resolution_clock::now();
-    return chrono::nanoseconds(endTime - startTime).count() / 1000000;
-}
-}
-
 namespace servus
 {
 namespace avahi
 {
+class Servus;
+
+class Connection;
+
 namespace
 {
-AvahiSimplePoll* _newSimplePoll()
-{
-    ScopedLock lock(_mutex);
-    return avahi_simple_poll_new();
-}
+std::atomic<size_t> _nConnections(0);
 }
 
-class Servus : public servus::Servus::Impl
+/**
+ * The connection to the avahi daemon, shared by all Servus instances of the
+ * process.
+ *
+ * The event thread of the connection runs the avahi callbacks of all
+ * instances, which only queue their results. Calls into avahi from other
+ * threads have to hold the Lock, which is never held while running listeners,
+ * so that instances do not wait for each other.
+ */
+class Connection
 {
 public:
-    explicit Servus(const std::string& name)
-        : servus::Servus::Impl(name)
-        , _poll(_newSimplePoll())
+    /** @return the shared connection, created on first use. */
+    static std::shared_ptr<Connection> get()
+    {
+        static std::mutex mutex;
+        static std::weak_ptr<Connection> shared;
+
+        ScopedLock lock(mutex);
+        std::shared_ptr<Connection> connection = shared.lock();
+        if (!connection || connection->_failed)
+        {
+            connection.reset(new Connection);
+            shared = connection;
+        }
+        return connection;
+    }
+
+    ~Connection()
+    {
+        avahi_threaded_poll_stop(_poll);
+        avahi_client_free(_client);
+        avahi_threaded_poll_free(_poll);
+        --_nConnections;
+    }
+
+    /** Serializes calls into avahi with the event thread. */
+    class Lock
+    {
+    public:
+        explicit Lock(const Connection& connection)
+            : _poll(connection._poll)
+        {
+            avahi_threaded_poll_lock(_poll);
+        }
+        ~Lock() { avahi_threaded_poll_unlock(_poll); }
+    private:
+        AvahiThreadedPoll* const _poll;
+    };
+
+    AvahiClient* getClient() const { return _client; }
+    const AvahiPoll* getPoll() const { return avahi_threaded_poll_get(_poll); }
+    /** @return true if services can be announced. Requires the Lock. */
+    bool isRunning() const { return _state == AVAHI_CLIENT_S_RUNNING; }
+    /** Add an instance for client state callbacks. Requires the Lock. */
+    void add(Servus* servus) { _instances.insert(servus); }
+    /** Remove an instance from client state callbacks. Requires the Lock. */
+    void remove(Servus* servus) { _instances.erase(servus); }
+private:
+    AvahiThreadedPoll* const _poll;
+    AvahiClient* _client;
+    AvahiClientState _state;
+    std::atomic<bool> _failed;
+    std::set<Servus*> _instances;
+
+    Connection()
+        : _poll(avahi_threaded_poll_new())
         , _client(0)
-        , _browser(0)
-        , _group(0)
-        , _result(servus::Servus::Result::PENDING)
-        , _port(0)
-        , _announcable(false)
-        , _scope(servus::Servus::IF_ALL)
+        , _state(AVAHI_CLIENT_CONNECTING)
+        , _failed(false)
     {
         if (!_poll)
             throw std::runtime_error("Can't setup avahi poll device");
 
         int error = 0;
-        ScopedLock lock(_mutex);
-        _client =
-            avahi_client_new(avahi_simple_poll_get(_poll),
-                             (AvahiClientFlags)(0), _clientCBS, this, &error);
+        _client = avahi_client_new(avahi_threaded_poll_get(_poll),
+                                   (AvahiClientFlags)(0), _clientCBS, this,
+                                   &error);
         if (!_client)
+        {
+            avahi_threaded_poll_free(_poll);
             throw std::runtime_error(std::string("Can't setup avahi client: ") +
                                      avahi_strerror(error));
+        }
+
+        if (avahi_threaded_poll_start(_poll) < 0)
+        {
+            avahi_client_free(_client);
+            avahi_threaded_poll_free(_poll);
+            throw std::runtime_error("Can't start avahi event thread");
+        }
+        ++_nConnections;
+    }
+
+    static void _clientCBS(AvahiClient*, AvahiClientState state,
+                           void* connection)
+    {
+        ((Connection*)connection)->_clientCB(state);
+    }
+
+    void _clientCB(AvahiClientState state);
+};
+
+class Servus : public servus::Servus::Impl
+{
+public:
+    Servus(const std::string& name, const servus::Servus::EventLoop eventLoop)
+        : servus::Servus::Impl(name)
+        , _eventLoop(eventLoop)
+        , _connection(Connection::get())
+        , _client(_connection->getClient())
+        , _browser(0)
+        , _group(0)
+        , _updateTimeout(0)
+        , _result(servus::Servus::Result::PENDING)
+        , _port(0)
+        , _announcable(false)
+        , _pollError(false)
+        , _scope(servus::Servus::IF_ALL)
+        , _nEvents(0)
+        , _stopping(false)
+    {
+        {
+            Connection::Lock lock(*_connection);
+            _connection->add(this);
+            _announcable = _connection->isRunning();
+        }
+        if (_eventLoop == servus::Servus::EVENT_LOOP_THREAD)
+            _dispatcher = std::thread([this] { _dispatch(); });
     }
 
     virtual ~Servus()
@@ -94,46 +190,53 @@ public:
         withdraw();
         endBrowsing();
 
-        ScopedLock lock(_mutex);
-        if (_client)
-            avahi_client_free(_client);
-        if (_poll)
-            avahi_simple_poll_free(_poll);
+        if (_dispatcher.joinable())
+        {
+            {
+                ScopedLock lock(_eventMutex);
+                _stopping = true;
+            }
+            _eventCondition.notify_all();
+            _dispatcher.join();
+        }
+
+        Connection::Lock lock(*_connection);
+        if (_updateTimeout)
+            _connection->getPoll()->timeout_free(_updateTimeout);
+        if (_group)
+            avahi_entry_group_free(_group);
+        _connection->remove(this);
     }
 
+    static size_t getNumConnections() { return _nConnections; }
     std::string getClassName() const { return "avahi"; }
+    servus::Servus::EventLoop getEventLoop() const final { return _eventLoop; }
     servus::Servus::Result announce(const unsigned short port,
                                     const std::string& instance) final
     {
-        ScopedLock lock(_mutex);
+        {
+            Connection::Lock lock(*_connection);
 
-        _result = servus::Servus::Result::PENDING;
-        _port = port;
-        if (instance.empty())
-            _announce = getHostname();
-        else
-            _announce = instance;
+            _result = servus::Servus::Result::PENDING;
+            _port = port;
+            if (instance.empty())
+                _announce = getHostname();
+            else
+                _announce = instance;
 
-        if (_announcable)
-            _createServices();
-        else
-        {
-            const chrono::high_resolution_clock::time_point& startTime =
-                chrono::high_resolution_clock::now();
-            while (!_announcable &&
-                   _result == servus::Servus::Result::PENDING &&
-                   _elapsedMilliseconds(startTime) < ANNOUNCE_TIMEOUT)
-            {
-                avahi_simple_poll_iterate(_poll, ANNOUNCE_TIMEOUT);
-            }
+            if (_announcable)
+                _createServices();
         }
 
+        _wait(ANNOUNCE_TIMEOUT, [this] {
+            return _announcable || _result != servus::Servus::Result::PENDING;
+        });
         return servus::Servus::Result(_result);
     }
 
     void withdraw() final
     {
-        ScopedLock lock(_mutex);
+        Connection::Lock lock(*_connection);
         _announce.clear();
         _port = 0;
         if (_group)
@@ -142,7 +245,7 @@ public:
 
     bool isAnnounced() const final
     {
-        ScopedLock lock(_mutex);
+        Connection::Lock lock(*_connection);
         return (_group && !avahi_entry_group_is_empty(_group));
     }
 
@@ -152,9 +255,19 @@ public:
         if (_browser)
             return servus::Servus::Result(servus::Servus::Result::PENDING);
 
-        ScopedLock lock(_mutex);
+        {
+            // Listeners may call into avahi, so the instance lock is taken
+            // before and not while holding the connection lock.
+            ScopedLock lock(_mutex);
+            {
+                ScopedLock eventLock(_eventMutex);
+                _events.clear();
+            }
+            _clearInstances();
+        }
+
+        Connection::Lock lock(*_connection);
         _scope = addr;
-        _instanceMap.clear();
         _result = servus::Servus::Result::SUCCESS;
         _browser =
             avahi_service_browser_new(_client, AVAHI_IF_UNSPEC,
@@ -171,57 +284,59 @@ public:
 
     servus::Servus::Result browse(const int32_t timeout) final
     {
-        ScopedLock lock(_mutex);
-        _result = servus::Servus::Result::PENDING;
-        const chrono::high_resolution_clock::time_point& startTime =
-            chrono::high_resolution_clock::now();
+        // Events are processed by the event thread of the connection, wait for
+        // them and apply the ones queued for EVENT_LOOP_CALLER.
+        size_t nEvents;
+        {
+            ScopedLock lock(_eventMutex);
+            nEvents = _nEvents;
+        }
+        _wait(timeout, [this, nEvents, timeout] {
+            return timeout < 0 && _nEvents != nEvents;
+        });
 
-        size_t nErrors = 0;
-        do
+        if (_eventLoop == servus::Servus::EVENT_LOOP_CALLER)
         {
-            if (avahi_simple_poll_iterate(_poll, timeout) != 0)
+            Events events;
             {
-                if (++nErrors < 10)
-                    continue;
-
-                _result = servus::Servus::Result::POLL_ERROR;
-                break;
+                ScopedLock lock(_eventMutex);
+                events.swap(_events);
             }
-        } while (_elapsedMilliseconds(startTime) < timeout);
-
-        if (_result != servus::Servus::Result::POLL_ERROR)
-            _result = servus::Servus::Result::SUCCESS;
+            _apply(events);
+        }
 
-        return servus::Servus::Result(_result);
+        return servus::Servus::Result(_pollError
+                                          ? servus::Servus::Result::POLL_ERROR
+                                          : servus::Servus::Result::SUCCESS);
     }
 
     void endBrowsing() final
     {
-        ScopedLock lock(_mutex);
+        Connection::Lock lock(*_connection);
         if (_browser)
             avahi_service_browser_free(_browser);
         _browser = 0;
+
+        for (const auto& resolver : _resolvers)
+            avahi_service_resolver_free(resolver.first);
+        _resolvers.clear();
     }
 
     bool isBrowsing() const final { return _browser; }
-private:
-    AvahiSimplePoll* const _poll;
-    AvahiClient* _client;
-    AvahiServiceBrowser* _browser;
-    AvahiEntryGroup* _group;
-    int32_t _result;
-    std::string _announce;
-    unsigned short _port;
-    bool _announcable;
-    servus::Servus::Interface _scope;
+    void addListener(Listener* listener) final
+    {
+        ScopedLock lock(_mutex);
+        servus::Servus::Impl::addListener(listener);
+    }
 
-    // Client state change
-    static void _clientCBS(AvahiClient*, AvahiClientState state, void* servus)
+    void removeListener(Listener* listener) final
     {
-        ((Servus*)servus)->_clientCB(state);
+        ScopedLock lock(_mutex);
+        servus::Servus::Impl::removeListener(listener);
     }
 
-    void _clientCB(AvahiClientState state)
+    // Client state change, called by the Connection
+    void clientCB(const AvahiClientState state)
     {
         switch (state)
         {
@@ -234,27 +349,148 @@ private:
         case AVAHI_CLIENT_FAILURE:
             _result = avahi_client_errno(_client);
             WARN << "Client failure: " << avahi_strerror(_result) << std::endl;
-            avahi_simple_poll_quit(_poll);
+            _quit();
             break;
 
         case AVAHI_CLIENT_S_COLLISION:
             // Can't setup client
             _result = EEXIST;
-            avahi_simple_poll_quit(_poll);
+            _quit();
             break;
 
         case AVAHI_CLIENT_S_REGISTERING:
             // The server records are now being established. This might be
             // caused by a host name change. We need to wait for our own records
             // to register until the host name is properly established.
-            throw std::runtime_error(
-                "Unimplemented AVAHI_CLIENT_S_REGISTERING event");
-            // withdraw & _createServices ?
+            _announcable = false;
+            if (_group)
+                avahi_entry_group_reset(_group);
             break;
 
         case AVAHI_CLIENT_CONNECTING:
             /*nop*/;
         }
+        _notify();
+    }
+
+private:
+    /**
+     * A discovery result, applied by browse() for EVENT_LOOP_CALLER and by the
+     * dispatcher thread for EVENT_LOOP_THREAD.
+     */
+    struct Event
+    {
+        ValueMap values;
+        bool added;
+    };
+    /** The latest unapplied result of each instance */
+    typedef std::map<std::string, Event> Events;
+
+    const servus::Servus::EventLoop _eventLoop;
+    const std::shared_ptr<Connection> _connection;
+    AvahiClient* const _client;
+    AvahiServiceBrowser* _browser;
+    /** Resolvers of discovered instances, which report TXT changes */
+    std::map<AvahiServiceResolver*, std::string> _resolvers;
+    AvahiEntryGroup* _group;
+    AvahiTimeout* _updateTimeout; //!< deferred record update
+    std::atomic<int32_t> _result;
+    std::string _announce;
+    unsigned short _port;
+    std::atomic<bool> _announcable;
+    std::atomic<bool> _pollError;
+    servus::Servus::Interface _scope;
+
+    /**
+     * The instance lock, held while discovered data is applied and listeners
+     * are invoked. Taken before the connection lock.
+     */
+    std::mutex _mutex;
+    std::thread _dispatcher; //!< applies events for EVENT_LOOP_THREAD
+
+    std::mutex _eventMutex; //!< protects the members below
+    std::condition_variable _eventCondition;
+    size_t _nEvents; //!< processed events, for browse(-1)
+    Events _events;  //!< unapplied results
+    bool _stopping;  //!< stops the dispatcher thread
+
+    /** Wait for the event thread to satisfy pred, at most timeout ms. */
+    template <typename Predicate>
+    void _wait(const int32_t timeout, const Predicate& pred)
+    {
+        ScopedLock lock(_eventMutex);
+        const auto stop = [this, &pred] { return _pollError || pred(); };
+        if (timeout < 0)
+            _eventCondition.wait(lock, stop);
+        else
+            _eventCondition.wait_for(lock, chrono::milliseconds(timeout),
+                                     stop);
+    }
+
+    /** Wake up callers waiting in _wait() after an event was processed. */
+    void _notify()
+    {
+        {
+            ScopedLock lock(_eventMutex);
+            ++_nEvents;
+        }
+        _eventCondition.notify_all();
+    }
+
+    /** Abort event processing after an error. */
+    void _quit()
+    {
+        _pollError = true;
+        _notify();
+    }
+
+    /**
+     * Queue a discovery result for browse() or the dispatcher thread, which
+     * are woken up by the _notify() following each callback. Replaces the
+     * unapplied result of the same instance, so that the queue stays bounded
+     * by the number of instances if browse() is rarely called.
+     */
+    void _push(const std::string& instance, Event&& event)
+    {
+        ScopedLock lock(_eventMutex);
+        _events[instance] = std::move(event);
+    }
+
+    /** Apply discovery results and notify the listeners. */
+    void _apply(Events& events)
+    {
+        if (events.empty())
+            return;
+
+        ScopedLock lock(_mutex);
+        for (auto& i : events)
+        {
+            if (i.second.added)
+                _updateInstance(i.first, i.second.values);
+            else
+                _removeInstance(i.first);
+        }
+        _publish();
+    }
+
+    // Applies the queued events of an EVENT_LOOP_THREAD instance outside of
+    // the event thread, so that its listeners do not block other instances.
+    void _dispatch()
+    {
+        ScopedLock lock(_eventMutex);
+        while (true)
+        {
+            _eventCondition.wait(
+                lock, [this] { return _stopping || !_events.empty(); });
+            if (_stopping)
+                return;
+
+            Events events;
+            events.swap(_events);
+            lock.unlock();
+            _apply(events);
+            lock.lock();
+        }
     }
 
     // Browsing
@@ -266,6 +502,7 @@ private:
     {
         ((Servus*)servus)
             ->_browseCB(ifIndex, protocol, event, name, type, domain);
+        ((Servus*)servus)->_notify();
     }
 
     void _browseCB(const AvahiIfIndex ifIndex, const AvahiProtocol protocol,
@@ -277,30 +514,42 @@ private:
         case AVAHI_BROWSER_FAILURE:
             _result = avahi_client_errno(_client);
             WARN << "Browser failure: " << avahi_strerror(_result) << std::endl;
-            avahi_simple_poll_quit(_poll);
+            _quit();
             break;
 
         case AVAHI_BROWSER_NEW:
-            // We ignore the returned resolver object. In the callback function
-            // we free it. If the server is terminated before the callback
-            // function is called the server will free the resolver for us.
-            if (!avahi_service_resolver_new(_client, ifIndex, protocol, name,
-                                            type, domain, AVAHI_PROTO_UNSPEC,
-                                            (AvahiLookupFlags)(0), _resolveCBS,
-                                            this))
+        {
+            // The resolver keeps reporting changes of the instance until it
+            // is removed, fails, or browsing ends.
+            AvahiServiceResolver* resolver =
+                avahi_service_resolver_new(_client, ifIndex, protocol, name,
+                                           type, domain, AVAHI_PROTO_UNSPEC,
+                                           (AvahiLookupFlags)(0), _resolveCBS,
+                                           this);
+            if (resolver)
+                _resolvers[resolver] = name;
+            else
             {
                 _result = avahi_client_errno(_client);
                 WARN << "Error creating resolver: " << avahi_strerror(_result)
                      << std::endl;
-                avahi_simple_poll_quit(_poll);
+                _quit();
             }
             break;
+        }
 
         case AVAHI_BROWSER_REMOVE:
-            _instanceMap.erase(name);
-            for (Listener* listener : _listeners)
-                listener->instanceRemoved(name);
-
+            for (auto i = _resolvers.begin(); i != _resolvers.end();)
+            {
+                if (i->second != name)
+                {
+                    ++i;
+                    continue;
+                }
+                avahi_service_resolver_free(i->first);
+                i = _resolvers.erase(i);
+            }
+            _push(name, Event{ValueMap(), false});
             break;
 
         case AVAHI_BROWSER_ALL_FOR_NOW:
@@ -318,6 +567,7 @@ private:
                             void* servus)
     {
         ((Servus*)servus)->_resolveCB(resolver, event, name, host, txt, flags);
+        ((Servus*)servus)->_notify();
     }
 
     void _resolveCB(AvahiServiceResolver* resolver,
@@ -325,23 +575,29 @@ private:
                     const char* host, AvahiStringList* txt,
                     const AvahiLookupResultFlags flags)
     {
-        // If browsing through the local interface, consider only the local
-        // instances
-        if (_scope == servus::Servus::IF_LOCAL &&
-            !(flags & AVAHI_LOOKUP_RESULT_LOCAL))
-            return;
-
         switch (event)
         {
         case AVAHI_RESOLVER_FAILURE:
             _result = avahi_client_errno(_client);
             WARN << "Resolver error: " << avahi_strerror(_result) << std::endl;
+            _resolvers.erase(resolver);
+            avahi_service_resolver_free(resolver);
             break;
 
         case AVAHI_RESOLVER_FOUND:
         {
-            ValueMap& values = _instanceMap[name];
-            values["servus_host"] = host;
+            // If browsing through the local interface, consider only the local
+            // instances
+            if (_scope == servus::Servus::IF_LOCAL &&
+                !(flags & AVAHI_LOOKUP_RESULT_LOCAL))
+            {
+                _resolvers.erase(resolver);
+                avahi_service_resolver_free(resolver);
+                break;
+            }
+
+            Event found{ValueMap(), true};
+            found.values["servus_host"] = host;
             for (; txt; txt = txt->next)
             {
                 const std::string entry(reinterpret_cast<const char*>(
@@ -350,25 +606,83 @@ private:
                 const size_t pos = entry.find_first_of("=");
                 const std::string key = entry.substr(0, pos);
                 const std::string value = entry.substr(pos + 1);
-                values[key] = value;
+                found.values[key] = value;
             }
-            for (Listener* listener : _listeners)
-                listener->instanceAdded(name);
+            _push(name, std::move(found));
         }
         break;
         }
-
-        avahi_service_resolver_free(resolver);
     }
 
     void _updateRecord() final
+    {
+        Connection::Lock lock(*_connection);
+        _updateTXT();
+    }
+
+    void _deferUpdate(const unsigned delay) final
+    {
+        Connection::Lock lock(*_connection);
+        const AvahiPoll* poll = _connection->getPoll();
+        struct timeval when;
+        avahi_elapse_time(&when, delay, 0);
+
+        if (_updateTimeout)
+            poll->timeout_update(_updateTimeout, &when);
+        else
+            _updateTimeout =
+                poll->timeout_new(poll, &when, _updateTimeoutCBS, this);
+    }
+
+    // The poll timeout uses the wall clock, the update interval the steady
+    // clock: re-arm if it fires before the deferred update is due.
+    static void _updateTimeoutCBS(AvahiTimeout* timeout, void* servus)
+    {
+        unsigned remaining = 0;
+        if (((Servus*)servus)->_takeDeferredUpdate(&remaining))
+            ((Servus*)servus)->_updateTXT();
+        else if (remaining > 0)
+        {
+            struct timeval when;
+            avahi_elapse_time(&when, remaining, 0);
+            ((Servus*)servus)->_connection->getPoll()->timeout_update(timeout,
+                                                                    &when);
+        }
+    }
+
+    // Replaces only the TXT record of a published service, which avoids the
+    // withdraw, probe and re-announce cycle of a full re-registration.
+    // Requires the Lock.
+    void _updateTXT()
     {
         if (_announce.empty() || !_announcable)
             return;
 
-        if (_group)
-            avahi_entry_group_reset(_group);
-        _createServices();
+        if (!_group || avahi_entry_group_is_empty(_group))
+        {
+            _createServices();
+            return;
+        }
+
+        AvahiStringList* data = _newTXT();
+        const int result = avahi_entry_group_update_service_txt_strlst(
+            _group, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, (AvahiPublishFlags)(0),
+            _announce.c_str(), _name.c_str(), 0, data);
+        if (data)
+            avahi_string_list_free(data);
+
+        if (result != servus::Result::SUCCESS)
+            _createServices();
+    }
+
+    AvahiStringList* _newTXT() const
+    {
+        std::lock_guard<std::mutex> lock(_dataMutex);
+        AvahiStringList* data = 0;
+        for (const auto& i : _data)
+            data = avahi_string_list_add_pair(data, i.first.c_str(),
+                                              i.second.c_str());
+        return data;
     }
 
     void _createServices()
@@ -381,11 +695,7 @@ private:
         if (!_group)
             return;
 
-        AvahiStringList* data = 0;
-        for (const auto& i : _data)
-            data = avahi_string_list_add_pair(data, i.first.c_str(),
-                                              i.second.c_str());
-
+        AvahiStringList* data = _newTXT();
         _result = avahi_entry_group_add_service_strlst(
             _group, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, (AvahiPublishFlags)(0),
             _announce.c_str(), _name.c_str(), 0, 0, _port, data);
@@ -395,19 +705,20 @@ private:
 
         if (_result != servus::Result::SUCCESS)
         {
-            avahi_simple_poll_quit(_poll);
+            _quit();
             return;
         }
 
         _result = avahi_entry_group_commit(_group);
         if (_result != servus::Result::SUCCESS)
-            avahi_simple_poll_quit(_poll);
+            _quit();
     }
 
     static void _groupCBS(AvahiEntryGroup*, AvahiEntryGroupState state,
                           void* servus)
     {
         ((Servus*)servus)->_groupCB(state);
+        ((Servus*)servus)->_notify();
     }
 
     void _groupCB(const AvahiEntryGroupState state)
@@ -420,7 +731,7 @@ private:
         case AVAHI_ENTRY_GROUP_COLLISION:
         case AVAHI_ENTRY_GROUP_FAILURE:
             _result = EEXIST;
-            avahi_simple_poll_quit(_poll);
+            _quit();
             break;
 
         case AVAHI_ENTRY_GROUP_UNCOMMITED:
@@ -429,5 +740,15 @@ private:
         }
     }
 };
+
+inline void Connection::_clientCB(const AvahiClientState state)
+{
+    _state = state;
+    if (state == AVAHI_CLIENT_FAILURE)
+        _failed = true;
+
+    for (Servus* servus : _instances)
+        servus->clientCB(state);
+}
 }
 }
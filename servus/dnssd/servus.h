@@ -16,8 +16,12 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
 #ifndef _MSC_VER
 #include <arpa/inet.h>
+#include <poll.h>
 #include <sys/time.h>
 #include <unistd.h>
 #endif
@@ -25,26 +29,47 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
 
 #define WARN std::cerr << __FILE__ << ":" << __LINE__ << ": "
+#define RESOLVE_TIMEOUT 500 /*ms*/
+#define MAX_RESOLVES 32     // concurrently running DNSServiceResolve
 
 namespace servus
 {
 namespace dnssd
 {
+namespace
+{
+int _poll(pollfd* fds, const size_t nfds, const int timeout)
+{
+#ifdef _WIN32
+    return ::WSAPoll(fds, ULONG(nfds), timeout);
+#else
+    return ::poll(fds, nfds_t(nfds), timeout);
+#endif
+}
+}
+
 class Servus : public servus::Servus::Impl
 {
 public:
     explicit Servus(const std::string& name)
         : Servus::Impl(name)
         , _out(0)
+        , _connection(0)
         , _in(0)
         , _result(servus::Servus::Result::PENDING)
+        , _processed(false)
     {
     }
 
     virtual ~Servus()
     {
+        _stopUpdateTimer();
         withdraw();
         endBrowsing();
     }
@@ -59,6 +84,7 @@ public:
         TXTRecordRef record;
         _createTXTRecord(record);
 
+        std::unique_lock<std::recursive_mutex> lock(_outMutex);
         const servus::Servus::Result result(DNSServiceRegister(
             &_out, 0 /* flags */, 0 /* all interfaces */,
             instance.empty() ? 0 : instance.c_str(), _name.c_str(),
@@ -66,9 +92,23 @@ public:
             TXTRecordGetLength(&record), TXTRecordGetBytesPtr(&record),
             (DNSServiceRegisterReply)registerCBS_, this));
         TXTRecordDeallocate(&record);
+        lock.unlock();
 
         if (result)
-            return _handleEvents(_out, ANNOUNCE_TIMEOUT);
+        {
+            _result = servus::Servus::Result::PENDING;
+            _handleEvents(ANNOUNCE_TIMEOUT, [this] {
+                return _result != servus::Servus::Result::PENDING;
+            });
+
+            // not registered within the timeout is not an error
+            const servus::Servus::Result registered(
+                _result == servus::Servus::Result::PENDING
+                    ? int32_t(kDNSServiceErr_NoError)
+                    : _result);
+            _result = servus::Servus::Result::PENDING;
+            return registered;
+        }
 
         WARN << "DNSServiceRegister returned: " << result << std::endl;
         return result;
@@ -76,6 +116,7 @@ public:
 
     void withdraw() final
     {
+        std::lock_guard<std::recursive_mutex> lock(_outMutex);
         if (!_out)
             return;
 
@@ -90,37 +131,102 @@ public:
         if (_in)
             return servus::Servus::Result(servus::Servus::Result::PENDING);
 
-        _instanceMap.clear();
+        _clearInstances();
         return _browse(addr);
     }
 
     servus::Servus::Result browse(const int32_t timeout) final
     {
-        return _handleEvents(_in, timeout);
+        if (!_connection)
+            return servus::Servus::Result(kDNSServiceErr_Unknown);
+
+        // without timeout, wait for one batch of events and its resolves
+        _processed = false;
+        return _handleEvents(timeout, [this, timeout] {
+            return timeout < 0 && _processed && _resolves.empty();
+        });
     }
 
     void endBrowsing() final
     {
-        if (!_in)
+        if (!_connection)
             return;
 
-        DNSServiceRefDeallocate(_in);
+        // Deallocate the refs sharing the connection before the connection
+        for (const auto& resolve : _resolves)
+            DNSServiceRefDeallocate(resolve.first);
+        _resolves.clear();
+        for (const auto& monitor : _monitors)
+            DNSServiceRefDeallocate(monitor.first);
+        _monitors.clear();
+        _queuedResolves.clear();
+
+        if (_in)
+            DNSServiceRefDeallocate(_in);
         _in = 0;
+        DNSServiceRefDeallocate(_connection);
+        _connection = 0;
     }
 
     bool isBrowsing() const final { return _in != 0; }
 private:
-    DNSServiceRef _out; //!< used for announce()
-    DNSServiceRef _in;  //!< used to browse()
+    typedef std::chrono::steady_clock Clock;
+
+    /** A discovered instance waiting to be resolved. */
+    struct QueuedResolve
+    {
+        std::string name;
+        std::string type;
+        std::string domain;
+        uint32_t interfaceIdx;
+    };
+
+    /** A running resolve of a discovered instance. */
+    struct Resolve
+    {
+        std::string name;
+        Clock::time_point timeout;
+    };
+
+    /** A TXT record query of a resolved instance. */
+    struct Monitor
+    {
+        std::string name;
+        std::string host;
+    };
+
+    DNSServiceRef _out;        //!< used for announce()
+    /** Serializes the use of _out with the update timer thread */
+    std::recursive_mutex _outMutex;
+    DNSServiceRef _connection; //!< shared by _in and _resolves
+    DNSServiceRef _in;         //!< used to browse()
     int32_t _result;
-    std::string _browsedName;
+    bool _processed; //!< browse events were received by _handleEvents()
+    std::deque<QueuedResolve> _queuedResolves;
+    std::map<DNSServiceRef, Resolve> _resolves; //!< at most MAX_RESOLVES
+    /** TXT record queries of resolved instances, which report changes */
+    std::map<DNSServiceRef, Monitor> _monitors;
 
     servus::Servus::Result _browse(const ::servus::Servus::Interface addr)
     {
         assert(!_in);
-        const DNSServiceErrorType error =
-            DNSServiceBrowse(&_in, 0, addr, _name.c_str(), "",
-                             (DNSServiceBrowseReply)_browseCBS, this);
+        assert(!_connection);
+
+        // All browse and resolve operations share one connection to the
+        // daemon, so that resolves run concurrently and are served through a
+        // single socket.
+        DNSServiceErrorType error = DNSServiceCreateConnection(&_connection);
+        if (error == kDNSServiceErr_NoError)
+        {
+            DNSServiceRef in = _connection;
+            error = DNSServiceBrowse(&in, kDNSServiceFlagsShareConnection, addr,
+                                     _name.c_str(), "",
+                                     (DNSServiceBrowseReply)_browseCBS, this);
+            if (error == kDNSServiceErr_NoError)
+                _in = in;
+        }
+        else
+            _connection = 0;
 
         if (error != kDNSServiceErr_NoError)
         {
@@ -133,6 +239,7 @@ private:
 
     void _updateRecord() final
     {
+        std::lock_guard<std::recursive_mutex> lock(_outMutex);
         if (!_out)
             return;
 
@@ -147,8 +254,11 @@ private:
             WARN << "DNSServiceUpdateRecord error: " << error << std::endl;
     }
 
+    void _deferUpdate(const unsigned delay) final { _startUpdateTimer(delay); }
+
     void _createTXTRecord(TXTRecordRef& record)
     {
+        std::lock_guard<std::mutex> lock(_dataMutex);
         TXTRecordCreate(&record, 0, 0);
         for (const auto& i : _data)
         {
@@ -160,54 +270,83 @@ private:
         }
     }
 
-    servus::Servus::Result _handleEvents(DNSServiceRef service,
-                                         const int32_t timeout = -1)
+    /**
+     * Process the events of all active operations in one poll() call per
+     * iteration, until timeout or until done() returns true.
+     */
+    template <typename Done>
+    servus::Servus::Result _handleEvents(const int32_t timeout,
+                                         const Done& done)
     {
-        assert(service);
-        if (!service)
-            return servus::Servus::Result(kDNSServiceErr_Unknown);
-
-        const int fd = DNSServiceRefSockFD(service);
-        const int nfds = fd + 1;
-
-        assert(fd >= 0);
-        if (fd < 0)
-            return servus::Servus::Result(kDNSServiceErr_BadParam);
-
-        while (_result == servus::Servus::Result::PENDING)
+        const Clock::time_point stop =
+            Clock::now() + std::chrono::milliseconds(std::max(timeout, 0));
+        while (!done())
         {
-            fd_set fdSet;
-            FD_ZERO(&fdSet);
-            FD_SET(fd, &fdSet);
-
-            struct timeval tv;
-            tv.tv_sec = timeout / 1000;
-            tv.tv_usec = (timeout % 1000) * 1000;
+            _expireResolves();
+            const Clock::time_point now = Clock::now();
+            if (timeout >= 0 && now >= stop)
+                break;
 
-            const int result =
-                ::select(nfds, &fdSet, 0, 0, timeout < 0 ? 0 : &tv);
-            switch (result)
+            // wake up at the end of the timeout or the next resolve timeout
+            bool infinite = timeout < 0;
+            Clock::time_point wakeup = stop;
+            for (const auto& resolve : _resolves)
             {
-            case 0: // timeout
-                _result = kDNSServiceErr_NoError;
-                break;
+                if (infinite || resolve.second.timeout < wakeup)
+                    wakeup = resolve.second.timeout;
+                infinite = false;
+            }
+            const int64_t wait =
+                (std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::max(wakeup - now, Clock::duration::zero()))
+                     .count() +
+                 999) /
+                1000;
+
+            // the resolves share the socket of _connection
+            DNSServiceRef services[] = {_out, _connection};
+            pollfd fds[2];
+            size_t nfds = 0;
+            for (const DNSServiceRef service : services)
+            {
+                if (!service)
+                    continue;
+                const int fd = DNSServiceRefSockFD(service);
+                assert(fd >= 0);
+                if (fd < 0)
+                    return servus::Servus::Result(kDNSServiceErr_BadParam);
+                fds[nfds].fd = fd;
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                ++nfds;
+            }
+            if (nfds == 0)
+                return servus::Servus::Result(kDNSServiceErr_BadReference);
 
-            case -1: // error
-                WARN << "Select error: " << strerror(errno) << " (" << errno
+            const int result = _poll(fds, nfds, infinite ? -1 : int(wait));
+            if (result == 0) // timeout
+                continue;
+            if (result < 0)
+            {
+                WARN << "Poll error: " << strerror(errno) << " (" << errno
                      << ")" << std::endl;
-                if (errno != EINTR)
-                {
-                    withdraw();
-                    _result = errno;
-                }
-                break;
+                if (errno == EINTR)
+                    continue;
+                withdraw();
+                return servus::Servus::Result(errno);
+            }
+
+            for (size_t i = 0; i < nfds; ++i)
+            {
+                if (!fds[i].revents)
+                    continue;
 
-            default:
-                if (FD_ISSET(fd, &fdSet))
+                // callbacks may have ended announcing or browsing meanwhile
+                if (_out && fds[i].fd == DNSServiceRefSockFD(_out))
                 {
+                    std::lock_guard<std::recursive_mutex> lock(_outMutex);
                     const DNSServiceErrorType error =
-                        DNSServiceProcessResult(service);
-
+                        DNSServiceProcessResult(_out);
                     if (error != kDNSServiceErr_NoError)
                     {
                         WARN << "DNSServiceProcessResult error: " << error
@@ -216,13 +355,65 @@ private:
                         _result = error;
                     }
                 }
-                break;
+                else if (_connection &&
+                         fds[i].fd == DNSServiceRefSockFD(_connection))
+                {
+                    const DNSServiceErrorType error =
+                        DNSServiceProcessResult(_connection);
+                    if (error != kDNSServiceErr_NoError)
+                    {
+                        WARN << "DNSServiceProcessResult error: " << error
+                             << std::endl;
+                        return servus::Servus::Result(error);
+                    }
+                    _processed = true;
+                }
             }
         }
+        return servus::Servus::Result(kDNSServiceErr_NoError);
+    }
 
-        const servus::Servus::Result result(_result);
-        _result = servus::Servus::Result::PENDING; // reset for next operation
-        return result;
+    /** Start queued resolves while less than MAX_RESOLVES are running. */
+    void _startResolves()
+    {
+        while (_resolves.size() < MAX_RESOLVES && !_queuedResolves.empty())
+        {
+            const QueuedResolve queued = _queuedResolves.front();
+            _queuedResolves.pop_front();
+
+            DNSServiceRef service = _connection;
+            const DNSServiceErrorType error =
+                DNSServiceResolve(&service, kDNSServiceFlagsShareConnection,
+                                  queued.interfaceIdx, queued.name.c_str(),
+                                  queued.type.c_str(), queued.domain.c_str(),
+                                  (DNSServiceResolveReply)resolveCBS_, this);
+            if (error != kDNSServiceErr_NoError)
+            {
+                WARN << "DNSServiceResolve error: " << error << std::endl;
+                continue;
+            }
+
+            const Clock::time_point timeout =
+                Clock::now() + std::chrono::milliseconds(RESOLVE_TIMEOUT);
+            _resolves[service] = Resolve{queued.name, timeout};
+        }
+    }
+
+    /** Cancel resolves running longer than RESOLVE_TIMEOUT. */
+    void _expireResolves()
+    {
+        const Clock::time_point now = Clock::now();
+        for (auto i = _resolves.begin(); i != _resolves.end();)
+        {
+            if (i->second.timeout > now)
+            {
+                ++i;
+                continue;
+            }
+            DNSServiceRefDeallocate(i->first);
+            i = _resolves.erase(i);
+        }
+        _startResolves();
     }
 
     static void DNSSD_API registerCBS_(DNSServiceRef, DNSServiceFlags,
@@ -268,44 +459,130 @@ private:
 
         if (flags & kDNSServiceFlagsAdd)
         {
-            _browsedName = name;
-
-            DNSServiceRef service = 0;
-            const DNSServiceErrorType resolve =
-                DNSServiceResolve(&service, 0, interfaceIdx, name, type, domain,
-                                  (DNSServiceResolveReply)resolveCBS_, this);
-            if (resolve != kDNSServiceErr_NoError)
-                WARN << "DNSServiceResolve error: " << resolve << std::endl;
+            _queuedResolves.push_back(
+                QueuedResolve{name, type, domain, interfaceIdx});
+            _startResolves();
+        }
+        else // dns_sd.h: callback with the Add flag NOT set indicates a Remove
+        {
+            _cancelResolves(name);
+            _removeInstance(name);
+        }
+    }
 
-            if (service)
+    void _cancelResolves(const std::string& name)
+    {
+        _queuedResolves.erase(
+            std::remove_if(_queuedResolves.begin(), _queuedResolves.end(),
+                           [&name](const QueuedResolve& queued) {
+                               return queued.name == name;
+                           }),
+            _queuedResolves.end());
+
+        for (auto i = _resolves.begin(); i != _resolves.end();)
+        {
+            if (i->second.name != name)
             {
-                _handleEvents(service, 500);
-                DNSServiceRefDeallocate(service);
+                ++i;
+                continue;
             }
+            DNSServiceRefDeallocate(i->first);
+            i = _resolves.erase(i);
         }
-        else // dns_sd.h: callback with the Add flag NOT set indicates a Remove
+
+        for (auto i = _monitors.begin(); i != _monitors.end();)
         {
-            _instanceMap.erase(name);
-            for (Listener* listener : _listeners)
-                listener->instanceRemoved(name);
+            if (i->second.name != name)
+            {
+                ++i;
+                continue;
+            }
+            DNSServiceRefDeallocate(i->first);
+            i = _monitors.erase(i);
         }
     }
 
-    static void DNSSD_API resolveCBS_(DNSServiceRef, DNSServiceFlags,
-                            uint32_t /*interfaceIdx*/,
-                            DNSServiceErrorType error, const char* /*name*/,
-                            const char* host, uint16_t /*port*/,
-                            uint16_t txtLen, const unsigned char* txt,
-                            Servus* servus)
+    static void DNSSD_API resolveCBS_(DNSServiceRef service, DNSServiceFlags,
+                            uint32_t interfaceIdx, DNSServiceErrorType error,
+                            const char* fullname, const char* host,
+                            uint16_t /*port*/, uint16_t txtLen,
+                            const unsigned char* txt, Servus* servus)
     {
+        const auto i = servus->_resolves.find(service);
+        if (i == servus->_resolves.end())
+            return;
+
+        const std::string name = i->second.name;
         if (error == kDNSServiceErr_NoError)
-            servus->resolveCB_(host, txtLen, txt);
-        servus->_result = error;
+            servus->resolveCB_(name, host, txtLen, txt);
+        else
+            WARN << "Resolve callback error: " << error << std::endl;
+
+        // The resolve ends after the first answer, a TXT record query reports
+        // later changes. Listeners may have ended browsing meanwhile.
+        const auto j = servus->_resolves.find(service);
+        if (j == servus->_resolves.end())
+            return;
+
+        if (error == kDNSServiceErr_NoError)
+            servus->_startMonitor(name, host, fullname, interfaceIdx);
+        DNSServiceRefDeallocate(service);
+        servus->_resolves.erase(j);
+        servus->_startResolves();
+    }
+
+    /** Query the TXT record of a resolved instance to report its changes. */
+    void _startMonitor(const std::string& name, const char* host,
+                       const char* fullname, const uint32_t interfaceIdx)
+    {
+        DNSServiceRef service = _connection;
+        const DNSServiceErrorType error =
+            DNSServiceQueryRecord(&service, kDNSServiceFlagsShareConnection,
+                                  interfaceIdx, fullname, kDNSServiceType_TXT,
+                                  kDNSServiceClass_IN,
+                                  (DNSServiceQueryRecordReply)queryCBS_, this);
+        if (error != kDNSServiceErr_NoError)
+        {
+            WARN << "DNSServiceQueryRecord error: " << error << std::endl;
+            return;
+        }
+        _monitors[service] = Monitor{name, host};
+    }
+
+    static void DNSSD_API queryCBS_(DNSServiceRef service,
+                                    DNSServiceFlags flags,
+                                    uint32_t /*interfaceIdx*/,
+                                    DNSServiceErrorType error,
+                                    const char* /*fullname*/,
+                                    uint16_t /*rrtype*/, uint16_t /*rrclass*/,
+                                    uint16_t txtLen, const void* txt,
+                                    uint32_t /*ttl*/, Servus* servus)
+    {
+        const auto i = servus->_monitors.find(service);
+        if (i == servus->_monitors.end())
+            return;
+
+        if (error != kDNSServiceErr_NoError)
+        {
+            WARN << "TXT record query error: " << error << std::endl;
+            DNSServiceRefDeallocate(service);
+            servus->_monitors.erase(i);
+            return;
+        }
+
+        // removed records are reported by the browser
+        if (!(flags & kDNSServiceFlagsAdd))
+            return;
+
+        const Monitor monitor = i->second; // listeners may end browsing
+        servus->resolveCB_(monitor.name, monitor.host.c_str(), txtLen,
+                           (const unsigned char*)txt);
     }
 
-    void resolveCB_(const char* host, uint16_t txtLen, const unsigned char* txt)
+    void resolveCB_(const std::string& name, const char* host, uint16_t txtLen,
+                    const unsigned char* txt)
     {
-        ValueMap& values = _instanceMap[_browsedName];
+        ValueMap values;
         values["servus_host"] = host;
 
         char key[256] = {0};
@@ -320,8 +597,7 @@ private:
             values[key] = std::string(value, valueLen);
             ++i;
         }
-        for (Listener* listener : _listeners)
-            listener->instanceAdded(_browsedName);
+        _updateInstance(name, values);
     }
 };
 }
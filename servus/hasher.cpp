@@ -0,0 +1,136 @@
+/* Copyright (c) 2017, Human Brain Project
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "hasher.h"
+#include "md5/md5.hh"
+
+#include <algorithm>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace servus
+{
+namespace
+{
+const size_t READ_SIZE = 1 << 16;
+const size_t MAP_SIZE = 1 << 26; // a multiple of the page size
+
+bool _read(FILE* file, Hasher& hasher)
+{
+    unsigned char buffer[READ_SIZE];
+    size_t size;
+    while ((size = ::fread(buffer, 1, READ_SIZE, file)) > 0)
+        hasher.update(buffer, size);
+    const bool success = !::ferror(file);
+    ::fclose(file);
+    return success;
+}
+}
+
+class Hasher::Impl
+{
+public:
+    md5::MD5 md5;
+};
+
+Hasher::Hasher()
+    : _impl(new Impl)
+{
+}
+
+Hasher::~Hasher()
+{
+}
+
+Hasher::Hasher(Hasher&&) = default;
+Hasher& Hasher::operator=(Hasher&&) = default;
+
+Hasher& Hasher::update(const void* data, const size_t size)
+{
+    _impl->md5.update(static_cast<unsigned char*>(const_cast<void*>(data)),
+                      size);
+    return *this;
+}
+
+bool Hasher::updateFile(const std::string& filename)
+{
+#ifdef _WIN32
+    FILE* file = ::fopen(filename.c_str(), "rb");
+    return file && _read(file, *this);
+#else
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    // map regular files window by window, so that multi-GB files neither
+    // exhaust the address space nor are copied through a read buffer
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+    {
+        const off_t fileSize = info.st_size;
+        off_t offset = 0;
+        for (; offset < fileSize; offset += off_t(MAP_SIZE))
+        {
+            const size_t size =
+                size_t(std::min(off_t(MAP_SIZE), fileSize - offset));
+            void* data =
+                ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, offset);
+            if (data == MAP_FAILED)
+                break;
+            ::madvise(data, size, MADV_SEQUENTIAL);
+            update(data, size);
+            ::munmap(data, size);
+        }
+        if (offset >= fileSize)
+        {
+            ::close(fd);
+            return true;
+        }
+        if (offset > 0) // mapping failed after hashing some of the data
+        {
+            ::close(fd);
+            return false;
+        }
+    }
+
+    // read files which can't be mapped, e.g., pipes
+    FILE* file = ::fdopen(fd, "rb");
+    if (!file)
+    {
+        ::close(fd);
+        return false;
+    }
+    return _read(file, *this);
+#endif
+}
+
+uint128_t Hasher::finalize()
+{
+    _impl->md5.finalize();
+    uint128_t value;
+    _impl->md5.raw_digest(value.high(), value.low());
+    _impl->md5 = md5::MD5();
+    return value;
+}
+}
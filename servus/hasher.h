@@ -0,0 +1,82 @@
+/* Copyright (c) 2017, Human Brain Project
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SERVUS_HASHER_H
+#define SERVUS_HASHER_H
+
+#include <servus/api.h>
+#include <servus/types.h>
+#include <servus/uint128_t.h> // return value
+
+#include <memory> // unique_ptr
+
+namespace servus
+{
+/**
+ * Incremental computation of the 128 bit MD5 hash used by make_uint128().
+ *
+ * Data can be added in pieces of any size, including memory-mapped regions
+ * and whole files, without copying it. The hash of data added in several
+ * pieces equals make_uint128() of their concatenation.
+ *
+ * Example: @include tests/hasher.cpp
+ * @version 1.6
+ */
+class Hasher
+{
+public:
+    /** Construct a new hasher without any data. */
+    SERVUS_API Hasher();
+    SERVUS_API ~Hasher();
+    SERVUS_API Hasher(Hasher&&);
+    SERVUS_API Hasher& operator=(Hasher&&);
+
+    /** Add a range of bytes to the hash. */
+    SERVUS_API Hasher& update(const void* data, size_t size);
+
+    /** Add all characters of a string to the hash. */
+    Hasher& update(const std::string& string)
+    {
+        return update(string.data(), string.size());
+    }
+
+    /**
+     * Add the content of a file to the hash.
+     *
+     * The file is memory-mapped where supported, and read in blocks
+     * otherwise. Data read before an error remains part of the hash.
+     * @return true on success, false if the file could not be read.
+     */
+    SERVUS_API bool updateFile(const std::string& filename);
+
+    /**
+     * @return the hash of all data added since construction or the last
+     *         call to finalize(), which also restarts the hasher.
+     */
+    SERVUS_API uint128_t finalize();
+
+private:
+    Hasher(const Hasher&) = delete;
+    Hasher& operator=(const Hasher&) = delete;
+
+    class Impl;
+    std::unique_ptr<Impl> _impl;
+};
+}
+
+#endif // SERVUS_HASHER_H
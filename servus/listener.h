@@ -20,6 +20,9 @@
 #ifndef SERVUS_LISTENER_H
 #define SERVUS_LISTENER_H
 
+#include <string>
+#include <vector>
+
 namespace servus
 {
 /**
@@ -48,6 +51,32 @@ public:
      * @version 1.2
      */
     virtual void instanceRemoved(const std::string& instance) = 0;
+
+    /** A changed key/value pair of an instance. @version 1.6 */
+    struct Change
+    {
+        std::string key;
+        std::string oldValue; //!< empty if the key was added
+        std::string newValue; //!< empty if the key was removed
+    };
+    typedef std::vector<Change> Changes;
+
+    /**
+     * Called after the announced data of a known instance has changed.
+     *
+     * Only the changed keys are reported, sorted by key. The default
+     * implementation does nothing.
+     *
+     * @param instance the name of the updated instance.
+     * @param changes the added, modified and removed keys.
+     * @version 1.6
+     */
+    virtual void instanceUpdated(const std::string& instance,
+                                 const Changes& changes)
+    {
+        (void)instance;
+        (void)changes;
+    }
 };
 }
 
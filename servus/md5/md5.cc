@@ -79,11 +79,13 @@ void MD5::update (uint1 *input, size_t input_length) {
   // Compute number of bytes mod 64
   buffer_index = (unsigned int)((count[0] >> 3) & 0x3F);
 
-  // Update number of bits
-  if (  (count[0] += ((uint4) input_length << 3))<((uint4) input_length << 3) )
+  // Update number of bits, without truncating inputs of 4 GB or more
+  uint64_t bits = input_length;
+  bits <<= 3;
+  if (  (count[0] += (uint4) bits) < (uint4) bits )
     count[1]++;
 
-  count[1] += ((uint4)input_length >> 29);
+  count[1] += (uint4)(bits >> 32);
 
 
   buffer_space = 64 - buffer_index;  // how much space is left in buffer
@@ -0,0 +1,78 @@
+/* Copyright (c) 2017, Human Brain Project
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "serializableUint128.h"
+
+namespace servus
+{
+namespace
+{
+const size_t BINARY_SIZE = 16;
+
+void _store(uint8_t* bytes, const uint64_t value)
+{
+    for (size_t i = 0; i < 8; ++i)
+        bytes[i] = uint8_t(value >> (8 * i));
+}
+
+uint64_t _load(const uint8_t* bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i)
+        value |= uint64_t(bytes[i]) << (8 * i);
+    return value;
+}
+}
+
+bool SerializableUint128::_fromBinary(const void* data, const size_t size)
+{
+    if (size != BINARY_SIZE)
+        return false;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    _value = uint128_t(_load(bytes + 8), _load(bytes));
+    return true;
+}
+
+Serializable::Data SerializableUint128::_toBinary() const
+{
+    uint8_t* bytes = new uint8_t[BINARY_SIZE];
+    _store(bytes, _value.low());
+    _store(bytes + 8, _value.high());
+
+    Data data;
+    data.ptr.reset(bytes, std::default_delete<uint8_t[]>());
+    data.size = BINARY_SIZE;
+    return data;
+}
+
+bool SerializableUint128::_fromJSON(const std::string& json)
+{
+    const size_t begin = json.find('"');
+    const size_t end = json.rfind('"');
+    if (begin == std::string::npos || end == begin)
+        return false;
+
+    return _value.fromChars(json.data() + begin + 1, json.data() + end);
+}
+
+std::string SerializableUint128::_toJSON() const
+{
+    return "\"" + _value.getString() + "\"";
+}
+}
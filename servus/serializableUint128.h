@@ -0,0 +1,61 @@
+/* Copyright (c) 2017, Human Brain Project
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SERVUS_SERIALIZABLEUINT128_H
+#define SERVUS_SERIALIZABLEUINT128_H
+
+#include <servus/api.h>
+#include <servus/serializable.h> // base class
+#include <servus/uint128_t.h>    // member
+
+namespace servus
+{
+/**
+ * A Serializable holding a 128 bit integer.
+ *
+ * uint128_t is a plain value type; this wrapper is created only where a value
+ * has to be passed through the Serializable interface. The binary form is the
+ * low and high 64 bits in little endian byte order, the JSON form is the
+ * quoted string representation of the value.
+ * @version 1.6
+ */
+class SerializableUint128 : public Serializable
+{
+public:
+    /** Construct a new serializable holding the given value. */
+    explicit SerializableUint128(const uint128_t& value_ = uint128_t())
+        : _value(value_)
+    {
+    }
+
+    /** @return the held value. */
+    const uint128_t& get() const { return _value; }
+    /** Set a new value. */
+    void set(const uint128_t& value_) { _value = value_; }
+    std::string getTypeName() const final { return "servus::uint128_t"; }
+private:
+    uint128_t _value;
+
+    SERVUS_API bool _fromBinary(const void* data, const size_t size) final;
+    SERVUS_API Data _toBinary() const final;
+    SERVUS_API bool _fromJSON(const std::string& json) final;
+    SERVUS_API std::string _toJSON() const final;
+};
+}
+
+#endif // SERVUS_SERIALIZABLEUINT128_H
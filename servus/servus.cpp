@@ -20,9 +20,14 @@
 #include "servus.h"
 
 #include "listener.h"
+#include "snapshot.h"
 
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
 
 // for NI_MAXHOST
@@ -52,16 +57,47 @@ class Servus::Impl
 public:
     explicit Impl(const std::string& name)
         : _name(name)
+        , _snapshot(std::make_shared<const Snapshot>())
     {
     }
     virtual ~Impl() {}
     virtual std::string getClassName() const = 0;
+    virtual servus::Servus::EventLoop getEventLoop() const
+    {
+        return servus::Servus::EVENT_LOOP_CALLER;
+    }
 
     const std::string& getName() const { return _name; }
     void set(const std::string& key, const std::string& value)
     {
-        _data[key] = value;
-        _updateRecord();
+        {
+            std::lock_guard<std::mutex> lock(_dataMutex);
+            _data[key] = value;
+        }
+        _update();
+    }
+
+    void set(const ValueMap& values)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_dataMutex);
+            for (const auto& i : values)
+                _data[i.first] = i.second;
+        }
+        _update();
+    }
+
+    void setUpdateInterval(const unsigned interval)
+    {
+        std::lock_guard<std::mutex> lock(_dataMutex);
+        _updateInterval = std::chrono::milliseconds(interval);
+    }
+
+    /** Publish a deferred record update if the update interval has passed. */
+    void flushUpdate()
+    {
+        if (_takeDeferredUpdate())
+            _updateRecord();
     }
 
     Strings getKeys() const
@@ -99,80 +135,332 @@ public:
         if (res == Servus::Result::SUCCESS || res == Servus::Result::PENDING)
         {
             browse(browseTime);
+            publishChanges();
             if (res == Servus::Result::SUCCESS)
                 endBrowsing();
         }
         return getInstances();
     }
 
-    Strings getInstances() const
-    {
-        Strings instances;
-        for (auto i : _instanceMap)
-            instances.push_back(i.first);
-
-        return instances;
-    }
-
+    // The getters for discovered data read the published snapshot, since
+    // _instanceMap is modified concurrently by the browsing thread.
+    Strings getInstances() const { return getSnapshot()->getInstances(); }
     Strings getKeys(const std::string& instance) const
     {
-        Strings keys;
-        InstanceMapCIter i = _instanceMap.find(instance);
-        if (i == _instanceMap.end())
-            return keys;
-
-        for (auto j : i->second)
-            keys.push_back(j.first);
-        return keys;
+        return getSnapshot()->getKeys(instance);
     }
 
     bool containsKey(const std::string& instance, const std::string& key) const
     {
-        InstanceMapCIter i = _instanceMap.find(instance);
-        if (i == _instanceMap.end())
-            return false;
-
-        const ValueMap& values = i->second;
-        ValueMapCIter j = values.find(key);
-        if (j == values.end())
-            return false;
-        return true;
+        return getSnapshot()->containsKey(instance, key);
     }
 
-    const std::string& get(const std::string& instance,
-                           const std::string& key) const
+    std::string get(const std::string& instance, const std::string& key) const
     {
-        InstanceMapCIter i = _instanceMap.find(instance);
-        if (i == _instanceMap.end())
-            return _empty;
-
-        const ValueMap& values = i->second;
-        ValueMapCIter j = values.find(key);
-        if (j == values.end())
-            return _empty;
-        return j->second;
+        return getSnapshot()->get(instance, key).str();
     }
 
-    void addListener(Listener* listener)
+    // Backends invoking listeners from their own thread lock these
+    virtual void addListener(Listener* listener)
     {
         if (listener)
             _listeners.insert(listener);
     }
 
-    void removeListener(Listener* listener)
+    virtual void removeListener(Listener* listener)
     {
         if (listener)
             _listeners.erase(listener);
     }
 
-    void getData(servus::Servus::Data& data) const { data = _instanceMap; }
+    void getData(servus::Servus::Data& data) const
+    {
+        data = getSnapshot()->getData();
+    }
+
+    servus::Servus::SnapshotPtr getSnapshot() const
+    {
+        return std::atomic_load(&_snapshot);
+    }
+
+    uint64_t getVersion() const { return getSnapshot()->getVersion(); }
+    /**
+     * Publish a snapshot of the data discovered by the caller's thread.
+     * Backends running their own event loop publish from it.
+     */
+    void publishChanges()
+    {
+        if (getEventLoop() == servus::Servus::EVENT_LOOP_CALLER)
+            _publish();
+    }
+
 protected:
     const std::string _name;
     InstanceMap _instanceMap; //!< last discovered data
     ValueMap _data;           //!< self data to announce
     Listeners _listeners;
 
+    /**
+     * Replace the discovered values of an instance. Notifies the listeners
+     * about a new instance, or about the changed keys of a known instance.
+     */
+    void _updateInstance(const std::string& instance, ValueMap& values)
+    {
+        const auto i = _instanceMap.find(instance);
+        if (i == _instanceMap.end())
+        {
+            _instanceMap[instance].swap(values);
+            _changed = true;
+            _publishForListeners();
+            for (Listener* listener : _listeners)
+                listener->instanceAdded(instance);
+            return;
+        }
+
+        ValueMap& oldValues = i->second;
+        if (oldValues == values)
+            return;
+
+        Listener::Changes changes;
+        if (!_listeners.empty())
+            _diff(oldValues, values, changes);
+        oldValues.swap(values);
+        _changed = true;
+        _publishForListeners();
+
+        for (Listener* listener : _listeners)
+            listener->instanceUpdated(instance, changes);
+    }
+
+    /** Forget a discovered instance and notify the listeners. */
+    void _removeInstance(const std::string& instance)
+    {
+        if (_instanceMap.erase(instance) == 0)
+            return;
+
+        _changed = true;
+        _publishForListeners();
+        for (Listener* listener : _listeners)
+            listener->instanceRemoved(instance);
+    }
+
+    /**
+     * Forget all discovered instances when browsing restarts. Publishes the
+     * empty snapshot and notifies the listeners about each removed instance.
+     */
+    void _clearInstances()
+    {
+        if (_instanceMap.empty())
+            return;
+
+        Strings instances;
+        instances.reserve(_instanceMap.size());
+        for (const auto& i : _instanceMap)
+            instances.push_back(i.first);
+
+        _instanceMap.clear();
+        _changed = true;
+        _publish();
+        for (const std::string& instance : instances)
+            for (Listener* listener : _listeners)
+                listener->instanceRemoved(instance);
+    }
+
+    /** Publish a new snapshot if the discovered data has changed. */
+    void _publish()
+    {
+        if (!_changed)
+            return;
+
+        _changed = false;
+        const uint64_t version = _snapshot->getVersion() + 1;
+        std::atomic_store(&_snapshot, std::make_shared<const Snapshot>(
+                                          _instanceMap, version));
+    }
+
+    /** Protects _data against reads from a backend event thread */
+    mutable std::mutex _dataMutex;
+
     virtual void _updateRecord() = 0;
+
+    /**
+     * Called when an update is deferred by the update interval. Backends
+     * schedule a flush after the given delay, using their own event loop or
+     * _startUpdateTimer(). The default publishes it with the next set() or
+     * browse().
+     */
+    virtual void _deferUpdate(const unsigned /*delay*/) {}
+
+    /**
+     * Publish the deferred update from a timer thread after the given delay.
+     * _updateRecord() has to be thread-safe, and the destructor of the
+     * backend has to call _stopUpdateTimer().
+     */
+    void _startUpdateTimer(const unsigned delay)
+    {
+        std::lock_guard<std::mutex> lock(_timerMutex);
+        _timerDue = Clock::now() + std::chrono::milliseconds(delay);
+        _timerArmed = true;
+        if (!_timer.joinable())
+            _timer = std::thread([this] { _runUpdateTimer(); });
+        _timerCondition.notify_one();
+    }
+
+    /** Stop the timer thread before the backend is destroyed. */
+    void _stopUpdateTimer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_timerMutex);
+            _timerStopped = true;
+        }
+        _timerCondition.notify_one();
+        if (_timer.joinable())
+            _timer.join();
+    }
+
+    /**
+     * @param remaining set to the milliseconds until a pending deferred update
+     *                  is due, or to zero if none is pending.
+     * @return true if a deferred update is due, clearing it.
+     */
+    bool _takeDeferredUpdate(unsigned* remaining = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(_dataMutex);
+        const Clock::time_point now = Clock::now();
+        if (remaining)
+            *remaining = 0;
+        if (!_updateDeferred)
+            return false;
+        if (now < _nextUpdate)
+        {
+            if (remaining)
+                *remaining = _milliseconds(_nextUpdate - now);
+            return false;
+        }
+
+        _updateDeferred = false;
+        _nextUpdate = now + _updateInterval;
+        return true;
+    }
+
+private:
+    servus::Servus::SnapshotPtr _snapshot; //!< only written by the browser
+    bool _changed{false}; //!< _instanceMap differs from _snapshot
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::duration _updateInterval{Clock::duration::zero()};
+    Clock::time_point _nextUpdate;
+    bool _updateDeferred{false};
+
+    std::thread _timer; //!< see _startUpdateTimer()
+    std::mutex _timerMutex; //!< protects the members below
+    std::condition_variable _timerCondition;
+    Clock::time_point _timerDue;
+    bool _timerArmed{false};
+    bool _timerStopped{false};
+
+    void _runUpdateTimer()
+    {
+        std::unique_lock<std::mutex> lock(_timerMutex);
+        while (!_timerStopped)
+        {
+            if (!_timerArmed)
+            {
+                _timerCondition.wait(lock);
+                continue;
+            }
+            if (Clock::now() < _timerDue)
+            {
+                _timerCondition.wait_until(lock, _timerDue);
+                continue;
+            }
+
+            _timerArmed = false;
+            lock.unlock();
+            unsigned remaining = 0;
+            if (_takeDeferredUpdate(&remaining))
+                _updateRecord();
+            lock.lock();
+
+            if (remaining > 0 && !_timerArmed)
+            {
+                _timerDue = Clock::now() + std::chrono::milliseconds(remaining);
+                _timerArmed = true;
+            }
+        }
+    }
+
+    // Rounds up, so that a timer firing after the delay finds the update due
+    static unsigned _milliseconds(const Clock::duration duration)
+    {
+        return unsigned(
+            std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+                .count() + 1);
+    }
+
+    // Listeners read the change through the getters, which use the snapshot
+    void _publishForListeners()
+    {
+        if (!_listeners.empty())
+            _publish();
+    }
+
+    // Merge two sorted value maps into the list of changed keys
+    static void _diff(const ValueMap& oldValues, const ValueMap& newValues,
+                      Listener::Changes& changes)
+    {
+        ValueMapCIter i = oldValues.begin();
+        ValueMapCIter j = newValues.begin();
+        while (i != oldValues.end() || j != newValues.end())
+        {
+            if (j == newValues.end() ||
+                (i != oldValues.end() && i->first < j->first))
+            {
+                changes.push_back({i->first, i->second, std::string()});
+                ++i;
+            }
+            else if (i == oldValues.end() || j->first < i->first)
+            {
+                changes.push_back({j->first, std::string(), j->second});
+                ++j;
+            }
+            else
+            {
+                if (i->second != j->second)
+                    changes.push_back({i->first, i->second, j->second});
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    // Publish _data now, or coalesce it into one deferred update if the last
+    // one is younger than the update interval
+    void _update()
+    {
+        unsigned delay = 0;
+        {
+            std::lock_guard<std::mutex> lock(_dataMutex);
+            const Clock::time_point now = Clock::now();
+            if (now >= _nextUpdate)
+            {
+                _updateDeferred = false;
+                _nextUpdate = now + _updateInterval;
+            }
+            else if (_updateDeferred)
+                return; // already scheduled, will pick up this change
+            else
+            {
+                _updateDeferred = true;
+                delay = _milliseconds(_nextUpdate - now);
+            }
+        }
+
+        if (delay == 0)
+            _updateRecord();
+        else
+            _deferUpdate(delay);
+    }
 };
 }
 
@@ -189,8 +477,12 @@ namespace servus
 {
 namespace
 {
-std::unique_ptr<Servus::Impl> _chooseImplementation(const std::string& name)
+std::unique_ptr<Servus::Impl> _chooseImplementation(
+    const std::string& name, const Servus::EventLoop eventLoop)
 {
+#ifndef SERVUS_USE_AVAHI_CLIENT
+    (void)eventLoop; // only implemented by avahi
+#endif
     if (name == TEST_DRIVER)
         return std::unique_ptr<Servus::Impl>(new test::Servus);
     try
@@ -198,7 +490,8 @@ std::unique_ptr<Servus::Impl> _chooseImplementation(const std::string& name)
 #ifdef SERVUS_USE_DNSSD
         return std::unique_ptr<Servus::Impl>(new dnssd::Servus(name));
 #elif defined(SERVUS_USE_AVAHI_CLIENT)
-        return std::unique_ptr<Servus::Impl>(new avahi::Servus(name));
+        return std::unique_ptr<Servus::Impl>(
+            new avahi::Servus(name, eventLoop));
 #endif
         return std::unique_ptr<Servus::Impl>(new none::Servus(name));
     }
@@ -212,7 +505,12 @@ std::unique_ptr<Servus::Impl> _chooseImplementation(const std::string& name)
 }
 
 Servus::Servus(const std::string& name)
-    : _impl(_chooseImplementation(name))
+    : _impl(_chooseImplementation(name, EVENT_LOOP_CALLER))
+{
+}
+
+Servus::Servus(const std::string& name, const EventLoop eventLoop)
+    : _impl(_chooseImplementation(name, eventLoop))
 {
 }
 
@@ -228,11 +526,25 @@ bool Servus::isAvailable()
     return false;
 }
 
+size_t Servus::getNumConnections()
+{
+#ifdef SERVUS_USE_AVAHI_CLIENT
+    return avahi::Servus::getNumConnections();
+#else
+    return 0;
+#endif
+}
+
 const std::string& Servus::getName() const
 {
     return _impl->getName();
 }
 
+Servus::EventLoop Servus::getEventLoop() const
+{
+    return _impl->getEventLoop();
+}
+
 std::string Servus::Result::getString() const
 {
     const int32_t code = getCode();
@@ -303,6 +615,16 @@ void Servus::set(const std::string& key, const std::string& value)
     _impl->set(key, value);
 }
 
+void Servus::set(const std::map<std::string, std::string>& values)
+{
+    _impl->set(values);
+}
+
+void Servus::setUpdateInterval(const unsigned interval)
+{
+    _impl->setUpdateInterval(interval);
+}
+
 Strings Servus::getKeys() const
 {
     return _impl->getKeys();
@@ -316,7 +638,9 @@ const std::string& Servus::get(const std::string& key) const
 Servus::Result Servus::announce(const unsigned short port,
                                 const std::string& instance)
 {
-    return _impl->announce(port, instance);
+    const Result result = _impl->announce(port, instance);
+    _impl->publishChanges(); // DNS-SD may process browse events meanwhile
+    return result;
 }
 
 void Servus::withdraw()
@@ -341,7 +665,10 @@ Servus::Result Servus::beginBrowsing(const servus::Servus::Interface addr)
 
 Servus::Result Servus::browse(int32_t timeout)
 {
-    return _impl->browse(timeout);
+    _impl->flushUpdate();
+    const Result result = _impl->browse(timeout);
+    _impl->publishChanges();
+    return result;
 }
 
 void Servus::endBrowsing()
@@ -364,7 +691,7 @@ Strings Servus::getKeys(const std::string& instance) const
     return _impl->getKeys(instance);
 }
 
-const std::string& Servus::getHost(const std::string& instance) const
+std::string Servus::getHost(const std::string& instance) const
 {
     return get(instance, "servus_host");
 }
@@ -375,8 +702,8 @@ bool Servus::containsKey(const std::string& instance,
     return _impl->containsKey(instance, key);
 }
 
-const std::string& Servus::get(const std::string& instance,
-                               const std::string& key) const
+std::string Servus::get(const std::string& instance,
+                        const std::string& key) const
 {
     return _impl->get(instance, key);
 }
@@ -396,6 +723,16 @@ void Servus::getData(Data& data)
     _impl->getData(data);
 }
 
+Servus::SnapshotPtr Servus::getSnapshot() const
+{
+    return _impl->getSnapshot();
+}
+
+uint64_t Servus::getVersion() const
+{
+    return _impl->getVersion();
+}
+
 std::string getHostname()
 {
     char hostname[NI_MAXHOST + 1] = {0};
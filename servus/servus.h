@@ -54,6 +54,25 @@ public:
         IF_LOCAL = (unsigned)(-1) //!< only local interfaces
     };
 
+    /** The event processing model of a service handle. @version 1.6 */
+    enum EventLoop
+    {
+        /**
+         * Discovered data is updated and listeners are invoked by the caller
+         * in browse().
+         */
+        EVENT_LOOP_CALLER = 0,
+        /**
+         * Events are processed continuously by a background thread of the
+         * implementation. Listeners are invoked from a thread of the service,
+         * and slow listeners do not delay other services. They may use the
+         * getters, set(), announce(), withdraw() and isAnnounced() of the
+         * service, but must not browse or change the listeners, which are
+         * locked while a listener runs.
+         */
+        EVENT_LOOP_THREAD
+    };
+
     /**
      * The ZeroConf operation result code.
      *
@@ -81,6 +100,13 @@ public:
     /** @return true if a usable implementation is available. */
     SERVUS_API static bool isAvailable();
 
+    /**
+     * @return the number of connections to the zeroconf daemon currently
+     *         shared by all service handles of this process.
+     * @version 1.6
+     */
+    SERVUS_API static size_t getNumConnections();
+
     /**
      * Create a new service handle.
      *
@@ -89,12 +115,27 @@ public:
      */
     SERVUS_API explicit Servus(const std::string& name);
 
+    /**
+     * Create a new service handle using the given event processing model.
+     *
+     * Implementations without support for EVENT_LOOP_THREAD fall back to
+     * EVENT_LOOP_CALLER, see getEventLoop().
+     *
+     * @param name the service descriptor, e.g., "_hwsd._tcp"
+     * @param eventLoop the event processing model
+     * @version 1.6
+     */
+    SERVUS_API Servus(const std::string& name, EventLoop eventLoop);
+
     /** Destruct this service. @version 1.1 */
     SERVUS_API virtual ~Servus();
 
     /** @return the service name. @version 1.1 */
     SERVUS_API const std::string& getName() const;
 
+    /** @return the event processing model in use. @version 1.6 */
+    SERVUS_API EventLoop getEventLoop() const;
+
     /**
      * Set a key/value pair to be announced.
      *
@@ -109,6 +150,29 @@ public:
      */
     SERVUS_API void set(const std::string& key, const std::string& value);
 
+    /**
+     * Set multiple key/value pairs to be announced.
+     *
+     * All values are published in a single update of the announced record,
+     * instead of one update per key as with repeated calls to set().
+     *
+     * @version 1.6
+     */
+    SERVUS_API void set(const std::map<std::string, std::string>& values);
+
+    /**
+     * Set the minimum time between two updates of the announced record.
+     *
+     * Changes made by set() within this interval after the last update are
+     * coalesced into one deferred update, which is published in the
+     * background once the interval has passed. The default of 0 publishes
+     * every change immediately.
+     *
+     * @param interval the minimum update interval in milliseconds.
+     * @version 1.6
+     */
+    SERVUS_API void setUpdateInterval(unsigned interval);
+
     /** @return all (to be) announced keys. @version 1.1 */
     SERVUS_API Strings getKeys() const;
 
@@ -157,6 +221,9 @@ public:
     /**
      * Browse and process discovered key/value pairs.
      *
+     * With EVENT_LOOP_THREAD, discovered data is processed continuously and
+     * this method only waits for the given time.
+     *
      * @param timeout The time to spend browsing.
      * @return the success status of the operation.
      * @version 1.1
@@ -169,26 +236,40 @@ public:
     /** @return true if the local data is browsing. @version 1.1 */
     SERVUS_API bool isBrowsing() const;
 
-    /** @return all instances found during the last discovery. @version 1.1 */
+    /**
+     * @return all instances found during the last discovery.
+     *
+     * This and the other getters for discovered data below read the latest
+     * snapshot (see getSnapshot()), and may be called from any thread while
+     * another thread is browsing.
+     * @version 1.1
+     */
     SERVUS_API Strings getInstances() const;
 
     /** @return all keys discovered on the given instance. @version 1.1 */
     SERVUS_API Strings getKeys(const std::string& instance) const;
 
     /** @return the host corresponding to the given instance. @version 1.3 */
-    SERVUS_API const std::string& getHost(const std::string& instance) const;
+    SERVUS_API std::string getHost(const std::string& instance) const;
 
     /** @return true if the given key was discovered. @version 1.1 */
     SERVUS_API bool containsKey(const std::string& instance,
                                 const std::string& key) const;
 
-    /** @return the value of the given key and instance. @version 1.1 */
-    SERVUS_API const std::string& get(const std::string& instance,
-                                      const std::string& key) const;
+    /**
+     * @return the value of the given key and instance. Returned by value since
+     *         1.6, as the data may change concurrently.
+     * @version 1.1
+     */
+    SERVUS_API std::string get(const std::string& instance,
+                               const std::string& key) const;
 
     /**
      * Add a listener which is invoked according to its supported callbacks.
      *
+     * With EVENT_LOOP_THREAD, listeners may be added and removed from any
+     * thread while browsing, except from a listener.
+     *
      * @param listener the listener to be added, must not be nullptr
      * @version 1.2
      */
@@ -208,6 +289,26 @@ public:
     /** @internal */
     SERVUS_API void getData(Data& data);
 
+    /** Immutable discovered data, see snapshot.h. @version 1.6 */
+    typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+    /**
+     * @return the discovered data as of the last change.
+     *
+     * A new snapshot is published after a browse() or, in EVENT_LOOP_THREAD
+     * mode, after each event which changed the discovered data. Obtaining it
+     * does not copy any data, and the returned snapshot never changes.
+     * @version 1.6
+     */
+    SERVUS_API SnapshotPtr getSnapshot() const;
+
+    /**
+     * @return the version of the latest snapshot, to cheaply detect whether
+     *         the discovered data has changed.
+     * @version 1.6
+     */
+    SERVUS_API uint64_t getVersion() const;
+
     class Impl; //!< @internal
 
 private:
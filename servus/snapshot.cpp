@@ -0,0 +1,217 @@
+/* Copyright (c) 2017, Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace servus
+{
+namespace
+{
+static const size_t npos = std::numeric_limits<size_t>::max();
+static const uint32_t _unused = std::numeric_limits<uint32_t>::max();
+}
+
+namespace detail
+{
+class Snapshot
+{
+public:
+    Snapshot(const servus::Servus::Data& data, const uint64_t version_)
+        : version(version_)
+    {
+        for (const auto& instance : data)
+            for (const auto& value : instance.second)
+                keys.push_back(value.first);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        keys.shrink_to_fit();
+
+        // Values of an instance are sorted by key, and so are the key ids
+        size_t nEntries = 0;
+        size_t nBytes = 0;
+        for (const auto& instance : data)
+        {
+            nEntries += instance.second.size();
+            for (const auto& value : instance.second)
+                nBytes += value.second.size();
+        }
+
+        names.reserve(data.size());
+        offsets.reserve(data.size() + 1);
+        entryKeys.reserve(nEntries);
+        valueEnds.reserve(nEntries);
+        values.reserve(nBytes);
+        for (const auto& instance : data)
+        {
+            names.push_back(instance.first);
+            offsets.push_back(uint32_t(entryKeys.size()));
+            for (const auto& value : instance.second)
+            {
+                entryKeys.push_back(uint32_t(findKey(value.first)));
+                values.append(value.second);
+                valueEnds.push_back(uint32_t(values.size()));
+            }
+        }
+        offsets.push_back(uint32_t(entryKeys.size()));
+
+        // Open addressing with linear probing at a load factor below 0.5
+        if (names.empty())
+            return;
+        size_t size = 2;
+        while (size < 2 * names.size())
+            size <<= 1;
+        index.resize(size, _unused);
+
+        const size_t mask = size - 1;
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            size_t slot = std::hash<std::string>()(names[i]) & mask;
+            while (index[slot] != _unused)
+                slot = (slot + 1) & mask;
+            index[slot] = uint32_t(i);
+        }
+    }
+
+    /** @return the index of the given instance, or npos. */
+    size_t findInstance(const std::string& name) const
+    {
+        if (index.empty())
+            return npos;
+
+        const size_t mask = index.size() - 1;
+        for (size_t slot = std::hash<std::string>()(name) & mask;;
+             slot = (slot + 1) & mask)
+        {
+            const uint32_t i = index[slot];
+            if (i == _unused)
+                return npos;
+            if (names[i] == name)
+                return i;
+        }
+    }
+
+    /** @return the id of the given interned key, or npos. */
+    size_t findKey(const std::string& key) const
+    {
+        const auto i = std::lower_bound(keys.begin(), keys.end(), key);
+        if (i == keys.end() || *i != key)
+            return npos;
+        return i - keys.begin();
+    }
+
+    /** @return the index of the value of the given instance and key. */
+    size_t findValue(const std::string& instance, const std::string& key) const
+    {
+        const size_t i = findInstance(instance);
+        if (i == npos)
+            return npos;
+        const size_t id = findKey(key);
+        if (id == npos)
+            return npos;
+
+        const auto begin = entryKeys.begin() + offsets[i];
+        const auto end = entryKeys.begin() + offsets[i + 1];
+        const auto j = std::lower_bound(begin, end, uint32_t(id));
+        if (j == end || *j != id)
+            return npos;
+        return j - entryKeys.begin();
+    }
+
+    /** @return the value of the given entry. */
+    servus::Snapshot::Value getValue(const size_t entry) const
+    {
+        const uint32_t begin = entry == 0 ? 0 : valueEnds[entry - 1];
+        return servus::Snapshot::Value(values.data() + begin,
+                                       valueEnds[entry] - begin);
+    }
+
+    const uint64_t version;
+    Strings names;                   //!< instance names, sorted
+    Strings keys;                    //!< interned keys, sorted
+    std::vector<uint32_t> offsets;   //!< first entry of each instance
+    std::vector<uint32_t> entryKeys; //!< key id of each entry
+    std::string values;              //!< values of all entries
+    std::vector<uint32_t> valueEnds; //!< end of each entry's value
+    std::vector<uint32_t> index;     //!< hash index into names
+};
+}
+
+Snapshot::Snapshot(const Servus::Data& data, const uint64_t version)
+    : _impl(new detail::Snapshot(data, version))
+{
+}
+
+Snapshot::~Snapshot()
+{
+    delete _impl;
+}
+
+uint64_t Snapshot::getVersion() const
+{
+    return _impl->version;
+}
+
+const Strings& Snapshot::getInstances() const
+{
+    return _impl->names;
+}
+
+Strings Snapshot::getKeys(const std::string& instance) const
+{
+    Strings keys;
+    const size_t i = _impl->findInstance(instance);
+    if (i == npos)
+        return keys;
+
+    const uint32_t begin = _impl->offsets[i];
+    const uint32_t end = _impl->offsets[i + 1];
+    keys.reserve(end - begin);
+    for (uint32_t j = begin; j < end; ++j)
+        keys.push_back(_impl->keys[_impl->entryKeys[j]]);
+    return keys;
+}
+
+bool Snapshot::containsKey(const std::string& instance,
+                           const std::string& key) const
+{
+    return _impl->findValue(instance, key) != npos;
+}
+
+Snapshot::Value Snapshot::get(const std::string& instance,
+                              const std::string& key) const
+{
+    const size_t i = _impl->findValue(instance, key);
+    return i == npos ? Value() : _impl->getValue(i);
+}
+
+Servus::Data Snapshot::getData() const
+{
+    Servus::Data data;
+    for (size_t i = 0; i < _impl->names.size(); ++i)
+    {
+        std::map<std::string, std::string>& values = data[_impl->names[i]];
+        for (uint32_t j = _impl->offsets[i]; j < _impl->offsets[i + 1]; ++j)
+            values[_impl->keys[_impl->entryKeys[j]]] = _impl->getValue(j).str();
+    }
+    return data;
+}
+}
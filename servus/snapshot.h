@@ -0,0 +1,94 @@
+/* Copyright (c) 2017, Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SERVUS_SNAPSHOT_H
+#define SERVUS_SNAPSHOT_H
+
+#include <servus/api.h>
+#include <servus/servus.h> // Servus::Data
+#include <servus/types.h>
+#include <servus/uri.h> // URI::Part
+
+namespace servus
+{
+namespace detail
+{
+class Snapshot;
+}
+
+/**
+ * Immutable discovered data of a Servus instance at one point in time.
+ *
+ * The data is stored in flat arrays: instance names are found through a hash
+ * index, keys are interned and the values of all instances are concatenated
+ * into one buffer. Lookups therefore do not chase the pointers of nested maps,
+ * and each value only costs its bytes and one offset.
+ *
+ * @sa Servus::getSnapshot()
+ * @version 1.6
+ */
+class Snapshot
+{
+public:
+    /** A value, viewed in the storage of the snapshot. @version 1.6 */
+    typedef URI::Part Value;
+
+    /**
+     * Construct a snapshot of the given data.
+     *
+     * @param data key/value pairs by instance name.
+     * @param version the version of the data.
+     * @version 1.6
+     */
+    SERVUS_API explicit Snapshot(const Servus::Data& data = Servus::Data(),
+                                 uint64_t version = 0);
+    SERVUS_API ~Snapshot();
+
+    /** @return the version, incremented with every change. @version 1.6 */
+    SERVUS_API uint64_t getVersion() const;
+
+    /** @return all instance names, sorted. @version 1.6 */
+    SERVUS_API const Strings& getInstances() const;
+
+    /** @return all keys of the given instance, sorted. @version 1.6 */
+    SERVUS_API Strings getKeys(const std::string& instance) const;
+
+    /** @return true if the given instance has the key. @version 1.6 */
+    SERVUS_API bool containsKey(const std::string& instance,
+                                const std::string& key) const;
+
+    /**
+     * @return the value of the given key and instance, or an empty value.
+     *         The value is valid for the lifetime of the snapshot.
+     * @version 1.6
+     */
+    SERVUS_API Value get(const std::string& instance,
+                         const std::string& key) const;
+
+    /** @return a copy of all data as nested maps. @version 1.6 */
+    SERVUS_API Servus::Data getData() const;
+
+private:
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    detail::Snapshot* const _impl;
+};
+}
+
+#endif
@@ -16,10 +16,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-#include <algorithm>
 #include <mutex>
 #include <set>
-#include <iterator>
 
 namespace servus
 {
@@ -46,6 +44,7 @@ public:
 
     virtual ~Servus()
     {
+        _stopUpdateTimer();
         withdraw();
         endBrowsing();
     }
@@ -61,6 +60,10 @@ public:
             _instance = getHostname();
         else
             _instance = instance;
+        {
+            std::lock_guard<std::mutex> dataLock(_dataMutex);
+            _record = _data;
+        }
         _directory.instances.insert(this);
         _announced = true;
         return servus::Servus::Result(servus::Result::SUCCESS);
@@ -83,7 +86,6 @@ public:
         if (_browsing)
             return servus::Servus::Result(servus::Servus::Result::PENDING);
 
-        _instances.clear();
         _browsing = true;
         return servus::Servus::Result(servus::Servus::Result::SUCCESS);
     }
@@ -92,37 +94,27 @@ public:
     {
         std::lock_guard<std::mutex> lock(_directory.mutex);
 
-        std::vector<Servus*> diff;
-        std::set_symmetric_difference(_directory.instances.begin(),
-                                      _directory.instances.end(),
-                                      _instances.begin(), _instances.end(),
-                                      back_inserter(diff));
+        // diff the announced instances against the discovered data, which
+        // also covers instances withdrawn between two browsing sessions
+        std::set<std::string> names;
+        for (auto i : _directory.instances)
+            names.insert(i->_instance);
+
+        Strings removed;
+        for (const auto& i : _instanceMap)
+            if (names.count(i.first) == 0)
+                removed.push_back(i.first);
+        for (const auto& name : removed)
+            _removeInstance(name);
 
-        _instanceMap.clear();
         for (auto i : _directory.instances)
         {
-            ValueMap& values = _instanceMap[i->_instance];
-            values.clear();
+            ValueMap values;
             values["servus_host"] = "localhost";
-
-            for (const auto& j : i->_data)
+            for (const auto& j : i->_record)
                 values[j.first] = j.second;
-        }
 
-        for (auto i : diff)
-        {
-            if (_instances.count(i) == 0)
-            {
-                _instances.insert(i);
-                for (Listener* listener : _listeners)
-                    listener->instanceAdded(i->_instance);
-            }
-            else
-            {
-                for (Listener* listener : _listeners)
-                    listener->instanceRemoved(i->_instance);
-                _instances.erase(i);
-            }
+            _updateInstance(i->_instance, values);
         }
         return servus::Servus::Result(servus::Servus::Result::SUCCESS);
     }
@@ -130,7 +122,6 @@ public:
     void endBrowsing() final
     {
         _browsing = false;
-        _instances.clear();
     }
 
     bool isBrowsing() const final { return _browsing; }
@@ -140,9 +131,16 @@ private:
     bool _announced{false};
     bool _browsing{false};
 
-    std::set<Servus*> _instances;
+    ValueMap _record; //!< announced data, as of the last record update
+
+    void _updateRecord() final
+    {
+        std::lock_guard<std::mutex> lock(_directory.mutex);
+        std::lock_guard<std::mutex> dataLock(_dataMutex);
+        _record = _data;
+    }
 
-    void _updateRecord() final { /*nop*/}
+    void _deferUpdate(const unsigned delay) final { _startUpdateTimer(delay); }
 };
 }
 }
@@ -49,10 +49,15 @@ typedef SSIZE_T ssize_t;
 
 namespace servus
 {
+class Hasher;
 class Listener;
 class Serializable;
+class SerializableUint128;
 class Servus;
+class Snapshot;
 class URI;
+class URIColumns;
+class URIView;
 class uint128_t;
 
 typedef unsigned long long ull_t;
@@ -0,0 +1,339 @@
+/* Copyright (c) 2017, Human Brain Project
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SERVUS_UINT128MAP_H
+#define SERVUS_UINT128MAP_H
+
+#include <servus/uint128_t.h> // key type
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace servus
+{
+namespace detail
+{
+inline const uint128_t& getKey(const uint128_t& value)
+{
+    return value;
+}
+
+template <typename T>
+const uint128_t& getKey(const std::pair<uint128_t, T>& value)
+{
+    return value.first;
+}
+
+/**
+ * @internal Open addressing hash table with linear probing for 128 bit keys.
+ *
+ * Each slot has a control byte, which is zero for empty slots and otherwise
+ * holds the top seven bits of the key's hash, so that most mismatching slots
+ * are skipped without comparing the 16 byte keys. Erased entries are removed
+ * by shifting the following entries back, which keeps probe sequences short
+ * without tombstones.
+ */
+template <typename V>
+class Uint128Table
+{
+    template <typename Table, typename Value>
+    class Iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename std::remove_const<Value>::type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Value* pointer;
+        typedef Value& reference;
+
+        Iterator()
+            : _table(nullptr)
+            , _index(0)
+        {
+        }
+
+        /** Convert an iterator into a const_iterator. */
+        template <typename T, typename U>
+        Iterator(const Iterator<T, U>& from)
+            : _table(from._table)
+            , _index(from._index)
+        {
+        }
+
+        Value& operator*() const { return _table->_values[_index]; }
+        Value* operator->() const { return &_table->_values[_index]; }
+        Iterator& operator++()
+        {
+            _index = _table->_next(_index + 1);
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            const Iterator i(*this);
+            ++*this;
+            return i;
+        }
+        bool operator==(const Iterator& rhs) const
+        {
+            return _index == rhs._index && _table == rhs._table;
+        }
+        bool operator!=(const Iterator& rhs) const { return !(*this == rhs); }
+    private:
+        template <typename, typename>
+        friend class Iterator;
+        friend class Uint128Table;
+
+        Iterator(Table* table, const size_t index)
+            : _table(table)
+            , _index(index)
+        {
+        }
+
+        Table* _table;
+        size_t _index;
+    };
+
+public:
+    typedef V value_type;
+    typedef Iterator<Uint128Table, V> iterator;
+    typedef Iterator<const Uint128Table, const V> const_iterator;
+
+    Uint128Table()
+        : _size(0)
+    {
+    }
+
+    /** @return the number of entries. */
+    size_t size() const { return _size; }
+    /** @return true if the table has no entries. */
+    bool empty() const { return _size == 0; }
+    /** @return the number of slots. */
+    size_t bucket_count() const { return _control.size(); }
+    /** Remove all entries, keeping the allocated slots. */
+    void clear()
+    {
+        std::fill(_control.begin(), _control.end(), 0);
+        std::fill(_values.begin(), _values.end(), V());
+        _size = 0;
+    }
+
+    /** Allocate enough slots for the given number of entries. */
+    void reserve(const size_t count)
+    {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity / 4 * 3 < count)
+            capacity *= 2;
+        if (capacity > bucket_count())
+            _rehash(capacity);
+    }
+
+    /** @return the entry with the given key, or end(). */
+    iterator find(const uint128_t& key)
+    {
+        return iterator(this, _find(key));
+    }
+
+    /** @return the entry with the given key, or end(). */
+    const_iterator find(const uint128_t& key) const
+    {
+        return const_iterator(this, _find(key));
+    }
+
+    /** @return 1 if an entry with the given key exists, 0 otherwise. */
+    size_t count(const uint128_t& key) const
+    {
+        return _find(key) == bucket_count() ? 0 : 1;
+    }
+
+    /**
+     * Insert an entry if its key does not exist yet.
+     * @return the entry with the key, and true if it was inserted.
+     */
+    std::pair<iterator, bool> insert(const V& value) { return _insert(value); }
+    /** @overload */
+    std::pair<iterator, bool> insert(V&& value)
+    {
+        return _insert(std::move(value));
+    }
+
+    /**
+     * Remove the entry with the given key.
+     *
+     * Invalidates all iterators, since following entries may move.
+     * @return the number of removed entries.
+     */
+    size_t erase(const uint128_t& key)
+    {
+        size_t hole = _find(key);
+        if (hole == bucket_count())
+            return 0;
+
+        // move back entries which are not at their home slot and may fill the
+        // hole without becoming unreachable
+        const size_t mask = bucket_count() - 1;
+        for (size_t i = (hole + 1) & mask; _control[i]; i = (i + 1) & mask)
+        {
+            const size_t home = _hash(getKey(_values[i])) & mask;
+            if (((i - home) & mask) < ((i - hole) & mask))
+                continue;
+
+            _values[hole] = std::move(_values[i]);
+            _control[hole] = _control[i];
+            hole = i;
+        }
+        _control[hole] = 0;
+        _values[hole] = V();
+        --_size;
+        return 1;
+    }
+
+    iterator begin() { return iterator(this, _next(0)); }
+    const_iterator begin() const { return const_iterator(this, _next(0)); }
+    iterator end() { return iterator(this, bucket_count()); }
+    const_iterator end() const { return const_iterator(this, bucket_count()); }
+protected:
+    static const size_t MIN_CAPACITY = 16;
+
+    std::vector<uint8_t> _control;
+    std::vector<V> _values;
+    size_t _size;
+
+    static uint64_t _hash(const uint128_t& key) { return detail::hash(key); }
+    static uint8_t _tag(const uint64_t hash)
+    {
+        return uint8_t(0x80 | (hash >> 57));
+    }
+    size_t _find(const uint128_t& key) const { return _find(key, _hash(key)); }
+    size_t _find(const uint128_t& key, const uint64_t hash) const
+    {
+        if (_size == 0)
+            return bucket_count();
+
+        const uint8_t tag = _tag(hash);
+        const size_t mask = bucket_count() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            if (_control[i] == tag && getKey(_values[i]) == key)
+                return i;
+            if (!_control[i])
+                return bucket_count();
+        }
+    }
+
+    template <typename Arg>
+    std::pair<iterator, bool> _insert(Arg&& value)
+    {
+        const uint128_t& key = getKey(value);
+        const uint64_t hash = _hash(key);
+        const size_t found = _find(key, hash);
+        if (found != bucket_count())
+            return std::make_pair(iterator(this, found), false);
+
+        // grow at a load factor of 3/4, which keeps linear probes short
+        if ((_size + 1) * 4 > bucket_count() * 3)
+            _rehash(_control.empty() ? size_t(MIN_CAPACITY)
+                                    : bucket_count() * 2);
+
+        const size_t mask = bucket_count() - 1;
+        size_t i = hash & mask;
+        while (_control[i])
+            i = (i + 1) & mask;
+
+        _control[i] = _tag(hash);
+        _values[i] = std::forward<Arg>(value);
+        ++_size;
+        return std::make_pair(iterator(this, i), true);
+    }
+
+    void _rehash(const size_t capacity)
+    {
+        std::vector<uint8_t> control(capacity, 0);
+        std::vector<V> values(capacity);
+        const size_t mask = capacity - 1;
+
+        for (size_t i = 0; i < bucket_count(); ++i)
+        {
+            if (!_control[i])
+                continue;
+            size_t j = _hash(getKey(_values[i])) & mask;
+            while (control[j])
+                j = (j + 1) & mask;
+            control[j] = _control[i];
+            values[j] = std::move(_values[i]);
+        }
+        _control.swap(control);
+        _values.swap(values);
+    }
+
+    size_t _next(size_t index) const
+    {
+        while (index < bucket_count() && !_control[index])
+            ++index;
+        return index;
+    }
+};
+}
+
+/**
+ * A hash map with 128 bit integer keys.
+ *
+ * Stores the entries in one flat array with open addressing, which avoids the
+ * per-entry allocation and pointer chasing of std::unordered_map. The mapped
+ * type has to be default constructible, and keys must not be modified through
+ * iterators. Inserting and erasing invalidates iterators.
+ *
+ * Example: @include tests/uint128Map.cpp
+ * @version 1.6
+ */
+template <typename T>
+class Uint128Map : public detail::Uint128Table<std::pair<uint128_t, T>>
+{
+    typedef detail::Uint128Table<std::pair<uint128_t, T>> Table;
+
+public:
+    typedef uint128_t key_type;
+    typedef T mapped_type;
+
+    /** @return the value for the key, inserting a default value if needed. */
+    T& operator[](const uint128_t& key)
+    {
+        typename Table::iterator i = Table::find(key);
+        if (i == Table::end())
+            i = Table::insert(std::make_pair(key, T())).first;
+        return i->second;
+    }
+};
+
+/**
+ * A hash set of 128 bit integers.
+ *
+ * Uses the same flat, open addressing storage as Uint128Map. Inserting and
+ * erasing invalidates iterators.
+ * @version 1.6
+ */
+class Uint128Set : public detail::Uint128Table<uint128_t>
+{
+public:
+    typedef uint128_t key_type;
+};
+}
+
+#endif // SERVUS_UINT128MAP_H
@@ -20,22 +20,227 @@
 #include "uint128_t.h"
 #include "md5/md5.hh"
 
-#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <random>
+#include <utility>
+#include <vector>
 
 #include <cassert>
 #include <cstdlib> // for strtoull
 #include <cstring> // for strcmp
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #ifdef _MSC_VER
 #define strtoull _strtoui64
 #endif
 
-using ScopedLock = std::unique_lock<std::mutex>;
-namespace chrono = std::chrono;
-
 namespace servus
 {
+namespace
+{
+/** The value of a hex digit, or -1 for other characters. */
+const int8_t _hexValues[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/** The two lower case hex digits of each byte. */
+const char _hexPairs[] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+/** @return the number of hex digits of the value without leading zeros. */
+size_t _numHexDigits(const uint64_t value)
+{
+#ifdef __GNUC__
+    return value ? size_t(67 - __builtin_clzll(value)) / 4 : 1;
+#else
+    size_t digits = 1;
+    for (uint64_t rest = value >> 4; rest; rest >>= 4)
+        ++digits;
+    return digits;
+#endif
+}
+
+/** Write the hex digits of the value without leading zeros. */
+char* _formatHex(char* out, const uint64_t value)
+{
+    const size_t digits = _numHexDigits(value);
+#if defined(__SSE2__) && defined(__GNUC__)
+    // spread the nibbles of the big endian value over 16 bytes and map them
+    // to '0'-'9' and 'a'-'f'
+    const uint64_t bigEndian = __builtin_bswap64(value);
+    const __m128i bytes = _mm_loadl_epi64((const __m128i*)&bigEndian);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i nibbles =
+        _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask),
+                          _mm_and_si128(bytes, mask));
+    const __m128i letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+    const __m128i chars =
+        _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')),
+                     _mm_and_si128(letters, _mm_set1_epi8('a' - '0' - 10)));
+
+    char buffer[16];
+    _mm_storeu_si128((__m128i*)buffer, chars);
+    ::memcpy(out, buffer + 16 - digits, digits);
+#else
+    char* pos = out + digits;
+    uint64_t rest = value;
+    for (; pos - out >= 2; rest >>= 8)
+    {
+        pos -= 2;
+        ::memcpy(pos, _hexPairs + 2 * (rest & 0xff), 2);
+    }
+    if (pos != out)
+        *out = _hexPairs[2 * (rest & 0xf) + 1];
+#endif
+    return out + digits;
+}
+
+/**
+ * Parse the hex digits in [first, last) into value.
+ * @return the uint128_t::Result code.
+ */
+int32_t _parseHex(const char* first, const char* last, uint64_t& value)
+{
+    if (first == last)
+        return uint128_t::Result::EMPTY;
+    if (last - first > 16)
+        return uint128_t::Result::TOO_LONG;
+
+    // accumulate without branching, invalid characters set the sign bit
+    uint64_t result = 0;
+    int8_t invalid = 0;
+    for (; first != last; ++first)
+    {
+        const int8_t digit = _hexValues[uint8_t(*first)];
+        invalid |= digit;
+        result = (result << 4) | uint64_t(digit & 0xf);
+    }
+    if (invalid < 0)
+        return uint128_t::Result::INVALID_CHARACTER;
+    value = result;
+    return uint128_t::Result::SUCCESS;
+}
+}
+
+std::string uint128_t::Result::getString() const
+{
+    switch (code_)
+    {
+    case EMPTY:
+        return "empty value";
+    case INVALID_CHARACTER:
+        return "invalid character";
+    case TOO_LONG:
+        return "more than 16 hex digits";
+    default:
+        return servus::Result::getString();
+    }
+}
+
+uint128_t::Result uint128_t::fromChars(const char* first, const char* last)
+{
+    // parse the leading digits, up to the separator if there is one
+    uint64_t high = 0;
+    const char* separator = first;
+    for (; separator != last; ++separator)
+    {
+        const int8_t digit = _hexValues[uint8_t(*separator)];
+        if (digit < 0)
+            break;
+        high = (high << 4) | uint64_t(digit);
+    }
+
+    uint64_t low = 0;
+    int32_t result = Result::SUCCESS;
+    if (separator == first)
+        result = first == last || *first == ':' ? Result::EMPTY
+                                                : Result::INVALID_CHARACTER;
+    else if (separator - first > 16)
+        result = Result::TOO_LONG;
+    else if (separator == last) // short representation, high is 0
+        std::swap(high, low);
+    else if (*separator == ':')
+        result = _parseHex(separator + 1, last, low);
+    else if (last - separator >= 4 &&
+             ::strncmp(separator, "\\058" /* utf-8 ':' */, 4) == 0)
+    {
+        result = _parseHex(separator + 4, last, low);
+    }
+    else
+        result = Result::INVALID_CHARACTER;
+
+    if (result == Result::SUCCESS)
+    {
+        _high = high;
+        _low = low;
+    }
+    return Result(result);
+}
+
+char* uint128_t::toChars(char* first, char* last) const
+{
+    if (size_t(last - first) <
+        _numHexDigits(_high) + _numHexDigits(_low) + 1 /* : */)
+    {
+        return nullptr;
+    }
+    first = _formatHex(first, _high);
+    *first++ = ':';
+    return _formatHex(first, _low);
+}
+
+std::string uint128_t::getString() const
+{
+    char buffer[MAX_CHARS];
+    return std::string(buffer, toChars(buffer, buffer + MAX_CHARS));
+}
+
+std::string uint128_t::getShortString() const
+{
+    char buffer[32];
+    const char* end = _formatHex(_formatHex(buffer, _high), _low);
+    const size_t size = size_t(end - buffer);
+    const size_t tail = size < 3 ? size : 3;
+    return std::string(buffer, std::min(size, size_t(3))) + ".." +
+           std::string(end - tail, tail);
+}
+
+std::ostream& operator<<(std::ostream& os, const uint128_t& id)
+{
+    char buffer[uint128_t::MAX_CHARS + 1];
+    char* end = id.high() == 0 ? _formatHex(buffer, id.low())
+                               : id.toChars(buffer, buffer + sizeof(buffer));
+    *end = '\0';
+    return os << buffer;
+}
+
 uint128_t& uint128_t::operator=(const std::string& from)
 {
     if (from.empty())
@@ -45,6 +250,9 @@ uint128_t& uint128_t::operator=(const std::string& from)
         return *this;
     }
 
+    if (fromChars(from.data(), from.data() + from.size()))
+        return *this;
+
     char* next = 0;
     _high = ::strtoull(from.c_str(), &next, 16);
     assert(next != from.c_str());
@@ -72,6 +280,68 @@ uint128_t& uint128_t::operator=(const std::string& from)
     return *this;
 }
 
+namespace detail
+{
+namespace
+{
+unsigned _leadingZeros(const uint128_t& value)
+{
+    const uint64_t word = value.high() ? value.high() : value.low();
+    unsigned zeros = value.high() ? 0 : 64;
+    if (word == 0)
+        return 128;
+#ifdef __GNUC__
+    return zeros + unsigned(__builtin_clzll(word));
+#else
+    for (uint64_t bit = 1ull << 63; !(word & bit); bit >>= 1)
+        ++zeros;
+    return zeros;
+#endif
+}
+}
+
+uint128_t multiply(const uint128_t& a, const uint128_t& b)
+{
+    return uint128_t(mulhi(a.low(), b.low()) + a.high() * b.low() +
+                         a.low() * b.high(),
+                     a.low() * b.low());
+}
+
+uint128_t divide(const uint128_t& dividend, const uint128_t& divisor,
+                 uint128_t& remainder)
+{
+    assert(divisor != 0);
+    if (dividend.high() == 0 && divisor.high() == 0)
+    {
+        const uint64_t low = dividend.low();
+        remainder = uint128_t(0, low % divisor.low());
+        return uint128_t(0, low / divisor.low());
+    }
+    if (divisor > dividend)
+    {
+        remainder = dividend;
+        return uint128_t();
+    }
+
+    // shift-subtract, starting with the divisor aligned to the dividend
+    const unsigned shift = _leadingZeros(divisor) - _leadingZeros(dividend);
+    uint128_t shifted = divisor << shift;
+    uint128_t quotient;
+    remainder = dividend;
+    for (unsigned i = 0; i <= shift; ++i)
+    {
+        quotient <<= 1;
+        if (remainder >= shifted)
+        {
+            remainder -= shifted;
+            quotient.low() |= 1;
+        }
+        shifted >>= 1;
+    }
+    return quotient;
+}
+}
+
 uint128_t make_uint128(const char* string)
 {
     const md5::MD5 md5((unsigned char*)string);
@@ -80,28 +350,89 @@ uint128_t make_uint128(const char* string)
     return value;
 }
 
-uint128_t make_UUID()
+uint128_t make_uint128(const void* data, const size_t size)
+{
+    md5::MD5 md5;
+    md5.update(static_cast<unsigned char*>(const_cast<void*>(data)), size);
+    md5.finalize();
+    uint128_t value;
+    md5.raw_digest(value.high(), value.low());
+    return value;
+}
+
+namespace
+{
+/**
+ * @return the random engine of the calling thread, seeded from
+ *         std::random_device with its full state size.
+ */
+std::mt19937_64& _getEngine()
+{
+    struct Engine : public std::mt19937_64
+    {
+        Engine()
+        {
+            std::random_device device;
+            std::vector<std::seed_seq::result_type> seeds(state_size * 2);
+            for (auto& value : seeds)
+                value = device();
+            std::seed_seq sequence(seeds.begin(), seeds.end());
+            seed(sequence);
+        }
+    };
+    // Thread-local engines need no lock. One shared engine behind a mutex
+    // was a contention point, and re-seeding on each call increases the
+    // chance of collisions, see http://stackoverflow.com/questions/14711263
+    static thread_local Engine engine;
+    return engine;
+}
+
+uint128_t _makeUUID(std::mt19937_64& engine)
 {
     uint128_t value;
     while (value.high() == 0)
     {
-        static std::random_device device;
-        static std::mt19937_64 engine(device());
-        static std::uniform_int_distribution<uint64_t> generator(
-            0, std::numeric_limits<uint64_t>::max());
-#ifndef _MSC_VER
-        // The static state is hidden to users, so the function is made
-        // thread safe for robustness over performance.
-        // Also, creating a new generator each call seems to increases the
-        // chances of collissions up to a noticeable level.
-
-        // http://stackoverflow.com/questions/14711263
-        static std::mutex mutex;
-        ScopedLock lock(mutex);
-#endif
-        value.high() = generator(engine);
-        value.low() = generator(engine);
+        value.high() = engine();
+        value.low() = engine();
     }
     return value;
 }
 }
+
+uint128_t make_UUID()
+{
+    return _makeUUID(_getEngine());
+}
+
+void make_UUIDs(uint128_t* first, uint128_t* last)
+{
+    std::mt19937_64& engine = _getEngine();
+    for (; first != last; ++first)
+        *first = _makeUUID(engine);
+}
+
+uint128_t make_UUIDv7()
+{
+    // The 48 bit millisecond timestamp and the 12 bit counter form one
+    // clock value, which is incremented if the time did not advance since the
+    // last call. A counter overflow moves into the next millisecond.
+    static std::atomic<uint64_t> lastClock(0);
+    const uint64_t now =
+        uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count());
+    const uint64_t nowClock = (now & 0xffffffffffffull) << 12;
+
+    uint64_t last = lastClock.load(std::memory_order_relaxed);
+    uint64_t clock;
+    do
+        clock = std::max(nowClock, last + 1);
+    while (!lastClock.compare_exchange_weak(last, clock,
+                                            std::memory_order_relaxed));
+
+    // timestamp, version 7 and counter; variant 10 and 62 random bits
+    const uint64_t random = _getEngine()();
+    return uint128_t((clock >> 12) << 16 | 0x7000 | (clock & 0xfff),
+                     0x8000000000000000ull | (random >> 2));
+}
+}
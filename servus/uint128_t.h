@@ -22,10 +22,11 @@
 #define SERVUS_UINT128_H
 
 #include <servus/api.h>
-#include <servus/serializable.h>
+#include <servus/result.h>
 #include <servus/types.h>
 
 #include <sstream>
+#include <vector>
 #ifdef _MSC_VER
 // Don't include <servus/types.h> to be minimally intrusive for apps
 // using uint128_t
@@ -36,35 +37,102 @@ typedef UINT64 uint64_t;
 #include <stdint.h>
 #endif
 
+#if defined(__SIZEOF_INT128__)
+#define SERVUS_NATIVE_UINT128 //!< unsigned __int128 is available
+#endif
+
+// Division is constexpr only with native 128 bit integers, and the modifying
+// operators in addition need the relaxed constexpr rules of C++14.
+#ifdef SERVUS_NATIVE_UINT128
+#define SERVUS_UINT128_CONSTEXPR constexpr
+#if __cplusplus >= 201402L
+#define SERVUS_UINT128_CONSTEXPR14 constexpr
+#endif
+#else
+#define SERVUS_UINT128_CONSTEXPR inline
+#endif
+#ifndef SERVUS_UINT128_CONSTEXPR14
+#define SERVUS_UINT128_CONSTEXPR14 inline
+#endif
+
 namespace servus
 {
 class uint128_t;
-std::ostream& operator<<(std::ostream& os, const uint128_t& id);
+SERVUS_API std::ostream& operator<<(std::ostream& os, const uint128_t& id);
+
+namespace detail
+{
+#ifdef SERVUS_NATIVE_UINT128
+__extension__ typedef unsigned __int128 native_uint128_t;
+#endif
+
+/** @internal The high half of the product of the 32 bit halves' products. */
+constexpr uint64_t mulhi(const uint64_t ll, const uint64_t lh,
+                         const uint64_t hl, const uint64_t hh)
+{
+    return hh + (lh >> 32) + (hl >> 32) +
+           (((ll >> 32) + (lh & 0xffffffffull) + (hl & 0xffffffffull)) >> 32);
+}
+
+/** @internal The high 64 bits of the 128 bit product of two values. */
+constexpr uint64_t mulhi(const uint64_t a, const uint64_t b)
+{
+    return mulhi((a & 0xffffffffull) * (b & 0xffffffffull),
+                 (a & 0xffffffffull) * (b >> 32),
+                 (a >> 32) * (b & 0xffffffffull), (a >> 32) * (b >> 32));
+}
+
+/** @internal Portable 128 bit multiplication. */
+SERVUS_API uint128_t multiply(const uint128_t& a, const uint128_t& b);
+
+/** @internal Portable 128 bit division, undefined for a zero divisor. */
+SERVUS_API uint128_t divide(const uint128_t& dividend,
+                            const uint128_t& divisor, uint128_t& remainder);
+}
 
 /**
  * A base type for 128 bit unsigned integer values.
  *
+ * The arithmetic operators use the native unsigned __int128 type where the
+ * compiler provides it, and a portable implementation otherwise. Division by
+ * zero is undefined, and shifts by 128 or more bits result in zero.
+ *
+ * uint128_t is a trivially copyable 16 byte value: it can be copied with
+ * memcpy, used in std::atomic and constructed and compared in constant
+ * expressions. Use SerializableUint128 to pass a value as a Serializable.
+ *
  * Example: @include tests/uint128_t.cpp
  */
-class uint128_t : public Serializable
+class uint128_t
 {
 public:
-    /**
-     * Construct a new 128 bit integer with a default value.
-     */
-    explicit uint128_t(const unsigned long long low_ = 0)
-        : Serializable()
-        , _high(0)
-        , _low(low_)
+    /** The result of parsing a string representation. @version 1.6 */
+    class Result : public servus::Result
     {
-    }
+    public:
+        explicit Result(const int32_t code)
+            : servus::Result(code)
+        {
+        }
+        virtual ~Result() {}
+        SERVUS_API std::string getString() const override;
+
+        /** The string, or one of its halves, has no hex digits. */
+        static const int32_t EMPTY = -1;
+        /** The string contains a character which is not a hex digit. */
+        static const int32_t INVALID_CHARACTER = -2;
+        /** One of the halves has more than 16 hex digits. */
+        static const int32_t TOO_LONG = -3;
+    };
+
+    /** The maximum number of characters written by toChars(). @version 1.6 */
+    static const size_t MAX_CHARS = 33;
 
     /**
      * Construct a new 128 bit integer with a default value.
      */
-    explicit uint128_t(const unsigned long low_)
-        : Serializable()
-        , _high(0)
+    constexpr explicit uint128_t(const unsigned long long low_ = 0)
+        : _high(0)
         , _low(low_)
     {
     }
@@ -72,27 +140,25 @@ public:
     /**
      * Construct a new 128 bit integer with a default value.
      */
-    explicit uint128_t(const int low_)
-        : Serializable()
-        , _high(0)
+    constexpr explicit uint128_t(const unsigned long low_)
+        : _high(0)
         , _low(low_)
     {
     }
 
     /**
-     * Construct a new 128 bit integer with default values.
+     * Construct a new 128 bit integer with a default value.
      */
-    uint128_t(const servus::uint128_t& rhs)
-        : Serializable()
-        , _high(rhs._high)
-        , _low(rhs._low)
+    constexpr explicit uint128_t(const int low_)
+        : _high(0)
+        , _low(uint64_t(low_))
     {
     }
 
     /**
      * Construct a new 128 bit integer with default values.
      */
-    uint128_t(const uint64_t high_, const uint64_t low_)
+    constexpr uint128_t(const uint64_t high_, const uint64_t low_)
         : _high(high_)
         , _low(low_)
     {
@@ -112,15 +178,7 @@ public:
      * @return true if the uint128_t is a generated universally unique
      *         identifier.
      */
-    bool isUUID() const { return high() != 0; }
-    /** Assign another 128 bit value. */
-    uint128_t& operator=(const servus::uint128_t& rhs)
-    {
-        _high = rhs._high;
-        _low = rhs._low;
-        return *this;
-    }
-
+    constexpr bool isUUID() const { return _high != 0; }
     /** Assign another 64 bit value. */
     uint128_t& operator=(const uint64_t rhs)
     {
@@ -137,13 +195,41 @@ public:
         return *this;
     }
 
-    /** Assign an 128 bit value from a std::string. */
+    /**
+     * Assign an 128 bit value from a std::string.
+     *
+     * Strings which are not accepted by fromChars() are parsed leniently with
+     * strtoull for compatibility.
+     */
     SERVUS_API uint128_t& operator=(const std::string& from);
 
+    /**
+     * Parse the string representation in [first, last).
+     *
+     * Accepts up to 16 hex digits for the low value, or two groups of up to
+     * 16 hex digits separated by ':' or its escaped form "\058". The whole
+     * range has to be consumed, and the value is left unchanged on errors.
+     *
+     * @return the result of the parsing.
+     * @version 1.6
+     */
+    SERVUS_API Result fromChars(const char* first, const char* last);
+
+    /**
+     * Write the full string representation, as returned by getString(), to
+     * [first, last) without a terminating null character.
+     *
+     * @return the end of the written characters, or nullptr if the buffer is
+     *         too small. A buffer of MAX_CHARS characters is always large
+     *         enough.
+     * @version 1.6
+     */
+    SERVUS_API char* toChars(char* first, char* last) const;
+
     /**
      * @return true if the values are equal, false if not.
      **/
-    bool operator==(const servus::uint128_t& rhs) const
+    constexpr bool operator==(const servus::uint128_t& rhs) const
     {
         return _high == rhs._high && _low == rhs._low;
     }
@@ -151,7 +237,7 @@ public:
     /**
      * @return true if the values are different, false otherwise.
      **/
-    bool operator!=(const servus::uint128_t& rhs) const
+    constexpr bool operator!=(const servus::uint128_t& rhs) const
     {
         return _high != rhs._high || _low != rhs._low;
     }
@@ -159,7 +245,7 @@ public:
     /**
      * @return true if the values are equal, false otherwise.
      **/
-    bool operator==(const unsigned long long& low_) const
+    constexpr bool operator==(const unsigned long long& low_) const
     {
         return *this == uint128_t(low_);
     }
@@ -167,7 +253,7 @@ public:
     /**
      * @return true if the values are different, false otherwise.
      **/
-    bool operator!=(const unsigned long long& low_) const
+    constexpr bool operator!=(const unsigned long long& low_) const
     {
         return *this != uint128_t(low_);
     }
@@ -175,55 +261,39 @@ public:
     /**
      * @return true if this value is smaller than the RHS value.
      **/
-    bool operator<(const servus::uint128_t& rhs) const
+    constexpr bool operator<(const servus::uint128_t& rhs) const
     {
-        if (_high < rhs._high)
-            return true;
-        if (_high > rhs._high)
-            return false;
-        return _low < rhs._low;
+        return _high != rhs._high ? _high < rhs._high : _low < rhs._low;
     }
 
     /**
      * @return true if this value is bigger than the rhs value.
      */
-    bool operator>(const servus::uint128_t& rhs) const
+    constexpr bool operator>(const servus::uint128_t& rhs) const
     {
-        if (_high > rhs._high)
-            return true;
-        if (_high < rhs._high)
-            return false;
-        return _low > rhs._low;
+        return _high != rhs._high ? _high > rhs._high : _low > rhs._low;
     }
 
     /**
      * @return true if this value is smaller or equal than the
      *         RHS value.
      */
-    bool operator<=(const servus::uint128_t& rhs) const
+    constexpr bool operator<=(const servus::uint128_t& rhs) const
     {
-        if (_high < rhs._high)
-            return true;
-        if (_high > rhs._high)
-            return false;
-        return _low <= rhs._low;
+        return _high != rhs._high ? _high < rhs._high : _low <= rhs._low;
     }
 
     /**
      * @return true if this value is smaller or equal than the
      *         RHS value.
      */
-    bool operator>=(const servus::uint128_t& rhs) const
+    constexpr bool operator>=(const servus::uint128_t& rhs) const
     {
-        if (_high > rhs._high)
-            return true;
-        if (_high < rhs._high)
-            return false;
-        return _low >= rhs._low;
+        return _high != rhs._high ? _high > rhs._high : _low >= rhs._low;
     }
 
     /** Increment the value. */
-    uint128_t& operator++()
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator++()
     {
         ++_low;
         if (!_low)
@@ -233,7 +303,7 @@ public:
     }
 
     /** Decrement the value. */
-    uint128_t& operator--()
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator--()
     {
         if (!_low)
             --_high;
@@ -242,8 +312,11 @@ public:
     }
 
     /** Add value and return the new value. */
-    uint128_t& operator+=(const servus::uint128_t& rhs)
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator+=(const servus::uint128_t& rhs)
     {
+#ifdef SERVUS_NATIVE_UINT128
+        return _assign(_native() + rhs._native());
+#else
         const uint64_t oldLow = _low;
         _low += rhs._low;
         if (_low < oldLow) // overflow
@@ -251,34 +324,131 @@ public:
         else
             _high += rhs._high;
         return *this;
+#endif
+    }
+
+    /** Subtract value and return the new value. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator-=(const servus::uint128_t& rhs)
+    {
+#ifdef SERVUS_NATIVE_UINT128
+        return _assign(_native() - rhs._native());
+#else
+        const uint64_t oldLow = _low;
+        _low -= rhs._low;
+        if (_low > oldLow) // underflow
+            _high -= rhs._high + 1;
+        else
+            _high -= rhs._high;
+        return *this;
+#endif
+    }
+
+    /** Multiply with value and return the new value. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator*=(const servus::uint128_t& rhs)
+    {
+#ifdef SERVUS_NATIVE_UINT128
+        return _assign(_native() * rhs._native());
+#else
+        return *this = detail::multiply(*this, rhs);
+#endif
+    }
+
+    /** Divide by value and return the new value. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator/=(const servus::uint128_t& rhs)
+    {
+#ifdef SERVUS_NATIVE_UINT128
+        return _assign(_native() / rhs._native());
+#else
+        uint128_t remainder;
+        return *this = detail::divide(*this, rhs, remainder);
+#endif
+    }
+
+    /** Set to the remainder of the division by value. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator%=(const servus::uint128_t& rhs)
+    {
+#ifdef SERVUS_NATIVE_UINT128
+        return _assign(_native() % rhs._native());
+#else
+        uint128_t remainder;
+        detail::divide(*this, rhs, remainder);
+        return *this = remainder;
+#endif
+    }
+
+    /** Bitwise and with value. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator&=(const servus::uint128_t& rhs)
+    {
+        _high &= rhs._high;
+        _low &= rhs._low;
+        return *this;
+    }
+
+    /** Bitwise or with value. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator|=(const servus::uint128_t& rhs)
+    {
+        _high |= rhs._high;
+        _low |= rhs._low;
+        return *this;
+    }
+
+    /** Bitwise exclusive or with value. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator^=(const servus::uint128_t& rhs)
+    {
+        _high ^= rhs._high;
+        _low ^= rhs._low;
+        return *this;
+    }
+
+    /** Shift left by the given number of bits. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator<<=(const unsigned shift)
+    {
+        if (shift >= 128)
+            _high = _low = 0;
+        else if (shift >= 64)
+        {
+            _high = _low << (shift - 64);
+            _low = 0;
+        }
+        else if (shift > 0)
+        {
+            _high = (_high << shift) | (_low >> (64 - shift));
+            _low <<= shift;
+        }
+        return *this;
+    }
+
+    /** Shift right by the given number of bits. @version 1.6 */
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& operator>>=(const unsigned shift)
+    {
+        if (shift >= 128)
+            _high = _low = 0;
+        else if (shift >= 64)
+        {
+            _low = _high >> (shift - 64);
+            _high = 0;
+        }
+        else if (shift > 0)
+        {
+            _low = (_low >> shift) | (_high << (64 - shift));
+            _high >>= shift;
+        }
+        return *this;
     }
 
     /** @return the reference to the lower 64 bits of this 128 bit value. */
-    const uint64_t& low() const { return _low; }
+    constexpr const uint64_t& low() const { return _low; }
     /** @return the reference to the high 64 bits of this 128 bit value. */
-    const uint64_t& high() const { return _high; }
+    constexpr const uint64_t& high() const { return _high; }
     /** @return the reference to the lower 64 bits of this 128 bit value. */
     uint64_t& low() { return _low; }
     /** @return the reference to the high 64 bits of this 128 bit value. */
     uint64_t& high() { return _high; }
     /** @return a short, but not necessarily unique, string of the value. */
-    std::string getShortString() const
-    {
-        std::stringstream stream;
-        stream << std::hex << _high << _low;
-        const std::string str = stream.str();
-        return str.substr(0, 3) + ".." +
-               str.substr(str.length() - 3, std::string::npos);
-    }
+    SERVUS_API std::string getShortString() const;
 
     /** @return the full string representation of the value. */
-    std::string getString() const
-    {
-        // OPT: snprintf is faster than using std::stringstream
-        char buffer[34] /* 2 x 16 bytes + : + \0 */;
-        snprintf(buffer, 34, "%llx:%llx", ull_t(high()), ull_t(low()));
-        return std::string(buffer);
-    }
+    SERVUS_API std::string getString() const;
 
     /** Serialize this object to a boost archive. */
     template <class Archive>
@@ -288,22 +458,33 @@ public:
         ar& high();
     }
 
-    virtual std::string getTypeName() const { return "servus::uint128_t"; }
-
 private:
     uint64_t _high;
     uint64_t _low;
+
+#ifdef SERVUS_NATIVE_UINT128
+    constexpr detail::native_uint128_t _native() const
+    {
+        return detail::native_uint128_t(_high) << 64 | _low;
+    }
+
+    SERVUS_UINT128_CONSTEXPR14 uint128_t& _assign(
+        const detail::native_uint128_t value)
+    {
+        _high = uint64_t(value >> 64);
+        _low = uint64_t(value);
+        return *this;
+    }
+#endif
 };
 
-/** ostream operator for 128 bit unsigned integers. */
-inline std::ostream& operator<<(std::ostream& os, const uint128_t& id)
-{
-    if (id.high() == 0)
-        os << std::hex << id.low() << std::dec;
-    else
-        os << std::hex << id.high() << ':' << id.low() << std::dec;
-    return os;
-}
+/**
+ * ostream operator for 128 bit unsigned integers.
+ *
+ * Writes the low value only if the high value is zero, and does not change
+ * the formatting flags of the stream.
+ */
+SERVUS_API std::ostream& operator<<(std::ostream& os, const uint128_t& id);
 
 /** istream operator for 128 bit unsigned integers. */
 inline std::istream& operator>>(std::istream& is, uint128_t& id)
@@ -314,53 +495,158 @@ inline std::istream& operator>>(std::istream& is, uint128_t& id)
     return is;
 }
 
+#ifdef SERVUS_NATIVE_UINT128
+namespace detail
+{
+/** @internal */
+constexpr native_uint128_t toNative(const uint128_t& value)
+{
+    return native_uint128_t(value.high()) << 64 | value.low();
+}
+
+/** @internal */
+constexpr uint128_t fromNative(const native_uint128_t value)
+{
+    return uint128_t(uint64_t(value >> 64), uint64_t(value));
+}
+}
+#endif
+
 /** Add a 64 bit value to a 128 bit value. */
-inline uint128_t operator+(const servus::uint128_t& a, const uint64_t& b)
+constexpr uint128_t operator+(const servus::uint128_t& a, const uint64_t& b)
 {
-    uint128_t result = a;
-    result.low() += b;
-    if (result.low() < a.low())
-        ++result.high();
-    return result;
+    return uint128_t(a.high() + (a.low() + b < a.low()), a.low() + b);
 }
 
 /** Add two 128 bit values. */
-inline uint128_t operator+(const servus::uint128_t& a,
-                           const servus::uint128_t& b)
+constexpr uint128_t operator+(const servus::uint128_t& a,
+                              const servus::uint128_t& b)
 {
-    uint128_t result = a;
-    result += b;
-    return result;
+#ifdef SERVUS_NATIVE_UINT128
+    return detail::fromNative(detail::toNative(a) + detail::toNative(b));
+#else
+    return uint128_t(a.high() + b.high() + (a.low() + b.low() < a.low()),
+                     a.low() + b.low());
+#endif
 }
 
 /** Subtract a 64 bit value from a 128 bit value. */
-inline uint128_t operator-(const servus::uint128_t& a, const uint64_t& b)
+constexpr uint128_t operator-(const servus::uint128_t& a, const uint64_t& b)
+{
+    return uint128_t(a.high() - (a.low() < b), a.low() - b);
+}
+
+/** Subtract two 128 bit values. @version 1.6 */
+constexpr uint128_t operator-(const servus::uint128_t& a,
+                              const servus::uint128_t& b)
+{
+#ifdef SERVUS_NATIVE_UINT128
+    return detail::fromNative(detail::toNative(a) - detail::toNative(b));
+#else
+    return uint128_t(a.high() - b.high() - (a.low() < b.low()),
+                     a.low() - b.low());
+#endif
+}
+
+/** Multiply two 128 bit values. @version 1.6 */
+constexpr uint128_t operator*(const servus::uint128_t& a,
+                              const servus::uint128_t& b)
 {
-    uint128_t result = a;
-    result.low() -= b;
-    if (result.low() > a.low())
-        --result.high();
-    return result;
+#ifdef SERVUS_NATIVE_UINT128
+    return detail::fromNative(detail::toNative(a) * detail::toNative(b));
+#else
+    return uint128_t(detail::mulhi(a.low(), b.low()) + a.high() * b.low() +
+                         a.low() * b.high(),
+                     a.low() * b.low());
+#endif
+}
+
+/**
+ * Divide two 128 bit values.
+ *
+ * A constant expression only with native 128 bit integers.
+ * @version 1.6
+ */
+SERVUS_UINT128_CONSTEXPR uint128_t operator/(const servus::uint128_t& a,
+                                             const servus::uint128_t& b)
+{
+#ifdef SERVUS_NATIVE_UINT128
+    return detail::fromNative(detail::toNative(a) / detail::toNative(b));
+#else
+    uint128_t remainder;
+    return detail::divide(a, b, remainder);
+#endif
+}
+
+/**
+ * @return the remainder of the division of two 128 bit values.
+ *
+ * A constant expression only with native 128 bit integers.
+ * @version 1.6
+ */
+SERVUS_UINT128_CONSTEXPR uint128_t operator%(const servus::uint128_t& a,
+                                             const servus::uint128_t& b)
+{
+#ifdef SERVUS_NATIVE_UINT128
+    return detail::fromNative(detail::toNative(a) % detail::toNative(b));
+#else
+    uint128_t remainder;
+    detail::divide(a, b, remainder);
+    return remainder;
+#endif
 }
 
 /** Bitwise and operation on two 128 bit values. */
-inline uint128_t operator&(const servus::uint128_t& a,
-                           const servus::uint128_t& b)
+constexpr uint128_t operator&(const servus::uint128_t& a,
+                              const servus::uint128_t& b)
 {
-    uint128_t result = a;
-    result.high() &= b.high();
-    result.low() &= b.low();
-    return result;
+    return uint128_t(a.high() & b.high(), a.low() & b.low());
 }
 
 /** Bitwise or operation on two 128 bit values. */
-inline uint128_t operator|(const servus::uint128_t& a,
-                           const servus::uint128_t& b)
+constexpr uint128_t operator|(const servus::uint128_t& a,
+                              const servus::uint128_t& b)
+{
+    return uint128_t(a.high() | b.high(), a.low() | b.low());
+}
+
+/** Bitwise exclusive or operation on two 128 bit values. @version 1.6 */
+constexpr uint128_t operator^(const servus::uint128_t& a,
+                              const servus::uint128_t& b)
+{
+    return uint128_t(a.high() ^ b.high(), a.low() ^ b.low());
+}
+
+/** Bitwise complement of a 128 bit value. @version 1.6 */
+constexpr uint128_t operator~(const servus::uint128_t& a)
 {
-    uint128_t result = a;
-    result.high() |= b.high();
-    result.low() |= b.low();
-    return result;
+    return uint128_t(~a.high(), ~a.low());
+}
+
+/** Shift a 128 bit value left. @version 1.6 */
+constexpr uint128_t operator<<(const servus::uint128_t& a, const unsigned shift)
+{
+    return shift >= 128
+               ? uint128_t()
+               : shift >= 64
+                     ? uint128_t(a.low() << (shift - 64), 0)
+                     : shift > 0 ? uint128_t((a.high() << shift) |
+                                                 (a.low() >> (64 - shift)),
+                                             a.low() << shift)
+                                 : a;
+}
+
+/** Shift a 128 bit value right. @version 1.6 */
+constexpr uint128_t operator>>(const servus::uint128_t& a, const unsigned shift)
+{
+    return shift >= 128
+               ? uint128_t()
+               : shift >= 64
+                     ? uint128_t(0, a.high() >> (shift - 64))
+                     : shift > 0 ? uint128_t(a.high() >> shift,
+                                             (a.low() >> shift) |
+                                                 (a.high() << (64 - shift)))
+                                 : a;
 }
 
 /**
@@ -372,10 +658,19 @@ inline uint128_t operator|(const servus::uint128_t& a,
  */
 SERVUS_API uint128_t make_uint128(const char* string);
 
-/** Create a 128 bit integer based on a string. */
+/**
+ * Create a 128 bit integer based on the MD5 hash of a byte range.
+ *
+ * The range may contain null characters. Use servus::Hasher to hash data
+ * given in several pieces or stored in files.
+ * @version 1.6
+ */
+SERVUS_API uint128_t make_uint128(const void* data, size_t size);
+
+/** Create a 128 bit integer based on all characters of a string. */
 inline uint128_t make_uint128(const std::string& string)
 {
-    return make_uint128(string.c_str());
+    return make_uint128(string.data(), string.size());
 }
 
 /**
@@ -383,6 +678,65 @@ inline uint128_t make_uint128(const std::string& string)
  * identifier.
  */
 SERVUS_API uint128_t make_UUID();
+
+/**
+ * Fill [first, last) with generated universally unique identifiers.
+ *
+ * make_UUID() and make_UUIDs() use a random engine per thread and do not
+ * synchronize between threads.
+ * @version 1.6
+ */
+SERVUS_API void make_UUIDs(uint128_t* first, uint128_t* last);
+
+/** @return the given number of universally unique identifiers. @version 1.6 */
+inline std::vector<uint128_t> make_UUIDs(const size_t count)
+{
+    std::vector<uint128_t> uuids(count);
+    make_UUIDs(uuids.data(), uuids.data() + count);
+    return uuids;
+}
+
+/**
+ * Construct a new 128 bit integer with a time-ordered universally unique
+ * identifier in the UUID version 7 layout.
+ *
+ * The high value holds the Unix time in milliseconds in its upper 48 bits,
+ * followed by the version and a 12 bit counter for identifiers created in the
+ * same millisecond; the low value holds the variant and 62 random bits.
+ * Identifiers created by one process increase strictly with each call, so
+ * they sort by creation time. The result is always a UUID, see isUUID().
+ * @version 1.6
+ */
+SERVUS_API uint128_t make_UUIDv7();
+
+namespace detail
+{
+/** @internal Multiply to 128 bits and fold the product (wyhash's mum). */
+inline uint64_t mum(const uint64_t a, const uint64_t b)
+{
+#ifdef SERVUS_NATIVE_UINT128
+    const native_uint128_t product = native_uint128_t(a) * b;
+    return uint64_t(product >> 64) ^ uint64_t(product);
+#else
+    return mulhi(a, b) ^ (a * b);
+#endif
+}
+
+/**
+ * @internal Mix a 128 bit value into 64 bits.
+ *
+ * Folds the high half with a constant, and then the result xored with the low
+ * half. Multiplying the two halves directly would give zero for all values of
+ * one half if the other one cancels its constant.
+ */
+inline uint64_t hash(const uint128_t& value)
+{
+    const uint64_t high =
+        mum(value.high() ^ 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull);
+    return mum(high ^ value.low() ^ 0x8ebc6af09c88c6e3ull,
+               0x589965cc75374cc3ull);
+}
+}
 } // namespace servus
 
 namespace std
@@ -394,8 +748,7 @@ struct hash<servus::uint128_t>
 
     result_type operator()(const servus::uint128_t& in) const
     {
-        hash<uint64_t> forward;
-        return forward(in.high()) ^ forward(in.low());
+        return servus::detail::hash(in);
     }
 };
 
@@ -22,48 +22,26 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <exception>
 #include <iostream>
 #include <sstream>
-#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace servus
 {
-namespace
-{
-struct URIData
-{
-    URIData()
-        : port(0)
-    {
-    }
-
-    bool operator==(const URIData& rhs) const
-    {
-        return (userinfo == rhs.userinfo && host == rhs.host &&
-                port == rhs.port && path == rhs.path && query == rhs.query &&
-                fragment == rhs.fragment && queryMap == rhs.queryMap);
-    }
-
-    std::string scheme;
-    std::string userinfo;
-    std::string host;
-    uint16_t port;
-    std::string path;
-    std::string query;
-    std::string fragment;
-    URI::KVMap queryMap;
-};
-}
-
 namespace detail
 {
 class uri_parse : public std::exception
 {
 public:
-    explicit uri_parse(const std::string& uri)
+    uri_parse(const std::string& uri, const servus::URI::Result& result)
     {
-        _error = std::string("Error parsing URI string: ") + uri;
+        _error = std::string("Error parsing URI string: ") + uri + " (" +
+                 result.getString() + ")";
     }
 
     uri_parse(const uri_parse& excep) { _error = excep._error; }
@@ -73,344 +51,1007 @@ private:
     std::string _error;
 };
 
-enum URIPart
+bool _isSchemeChar(const char c)
+{
+    return ::isalnum(c) || c == '+' || c == '-' || c == '.';
+}
+
+/** Character classes for percent-encoding, one lookup per character. */
+class CharTable
 {
-    SCHEME = 0,
-    AUTHORITY,
-    PATH,
-    QUERY,
-    FRAGMENT
+public:
+    CharTable()
+    {
+        std::fill(_allowed, _allowed + 256, 0);
+        std::fill(_hex, _hex + 256, -1);
+        for (int c = '0'; c <= '9'; ++c)
+            _hex[c] = int8_t(c - '0');
+        for (int c = 'a'; c <= 'f'; ++c)
+            _hex[c] = _hex[c - 'a' + 'A'] = int8_t(c - 'a' + 10);
+
+        const uint8_t all = (1 << 5) - 1;
+        const uint8_t query = 1 << URI::COMPONENT_QUERY;
+        const uint8_t host = 1 << URI::COMPONENT_HOST;
+        _allow("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+               "0123456789-._~",
+               all | UNRESERVED);
+        _allow("!$'()*,;", all); // sub-delims, except the query separators
+        _allow("&=+", all & ~query);
+        _allow(":", all & ~host);
+        _allow("@/", all & ~host & ~(1 << URI::COMPONENT_USERINFO));
+        _allow("?", query | (1 << URI::COMPONENT_FRAGMENT));
+    }
+
+    bool isAllowed(const char c, const URI::Component component) const
+    {
+        return _allowed[uint8_t(c)] & (1 << component);
+    }
+    bool isUnreserved(const char c) const
+    {
+        return _allowed[uint8_t(c)] & UNRESERVED;
+    }
+    /** @return the value of the given hexadecimal digit, or -1. */
+    int hex(const char c) const { return _hex[uint8_t(c)]; }
+private:
+    static const uint8_t UNRESERVED = 1 << 7;
+    uint8_t _allowed[256]; //!< bit mask of URI::Component and UNRESERVED
+    int8_t _hex[256];
+
+    void _allow(const char* chars, const uint8_t mask)
+    {
+        for (; *chars; ++chars)
+            _allowed[uint8_t(*chars)] |= mask;
+    }
 };
 
-bool _parseURIPart(std::string& input, const URIPart& part, std::string& output)
+const CharTable& _chars()
 {
-#ifndef NDEBUG
-    const char requireFirst[] = {0, 0, 0, '?', '#'};
-#endif
-    const char* const separators[] = {"://", "/?#", "?#", "#", ""};
-    const char* const disallowed[] = {"/?#", 0, 0, 0, 0};
-    const bool fullSeparator[] = {true, false, false, false, false};
-    const bool needsSeparator[] = {true, false, false, false, false};
-    const size_t skip[] = {0, 0, 0, 1, 1};
-    const size_t postSkip[] = {3, 0, 0, 0, 0};
-    const size_t pos = fullSeparator[part]
-                           ? input.find(separators[part])
-                           : input.find_first_of(separators[part]);
-
-    if (pos == std::string::npos)
+    static const CharTable table;
+    return table;
+}
+
+/** Parse a dotted-decimal IPv4 address into four bytes. */
+bool _parseIPv4(const char* data, const size_t size, uint8_t* bytes)
+{
+    size_t pos = 0;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        if (i > 0 && (pos == size || data[pos++] != '.'))
+            return false;
+
+        const size_t begin = pos;
+        uint32_t value = 0;
+        for (; pos < size && pos - begin < 3 && ::isdigit(data[pos]); ++pos)
+            value = value * 10 + uint32_t(data[pos] - '0');
+        if (pos == begin || value > 255)
+            return false;
+        bytes[i] = uint8_t(value);
+    }
+    return pos == size;
+}
+
+/** Parse a textual IPv6 address (RFC4291, section 2.2) into 16 bytes. */
+bool _parseIPv6(const char* data, const size_t size, uint8_t* bytes)
+{
+    const CharTable& chars = _chars();
+    uint16_t groups[8];
+    size_t nGroups = 0;
+    size_t gap = 8; // position of "::", 8 if none
+    size_t pos = 0;
+
+    if (size >= 2 && data[0] == ':' && data[1] == ':')
+    {
+        gap = 0;
+        pos = 2;
+    }
+    while (pos < size)
     {
-        if (needsSeparator[part])
+        if (nGroups == 8)
+            return false;
+
+        size_t end = pos;
+        uint32_t value = 0;
+        for (; end < size && end - pos < 4 && chars.hex(data[end]) >= 0; ++end)
+            value = value * 16 + uint32_t(chars.hex(data[end]));
+
+        if (end < size && data[end] == '.') // embedded IPv4 address
+        {
+            uint8_t ipv4[4];
+            if (nGroups > 6 || !_parseIPv4(data + pos, size - pos, ipv4))
+                return false;
+            groups[nGroups++] = uint16_t(ipv4[0] << 8 | ipv4[1]);
+            groups[nGroups++] = uint16_t(ipv4[2] << 8 | ipv4[3]);
+            break;
+        }
+        if (end == pos)
+            return false;
+        groups[nGroups++] = uint16_t(value);
+
+        if (end == size)
+            break;
+        if (data[end] != ':' || end + 1 == size)
+            return false;
+        if (data[end + 1] == ':')
         {
-            output = "";
-            return true;
+            if (gap < 8)
+                return false;
+            gap = nGroups;
+            pos = end + 2;
         }
+        else
+            pos = end + 1;
     }
-    else if (pos == 0 ||
-             (disallowed[part] && input.find_first_of(disallowed[part]) < pos))
+
+    if (gap < 8 ? nGroups > 7 : nGroups != 8)
+        return false;
+
+    const size_t nZeros = 8 - nGroups;
+    for (size_t i = 0, j = 0; i < 8; ++i)
     {
-        output = "";
-        return true;
+        const bool zero = i >= gap && i < gap + nZeros;
+        const uint16_t group = zero ? 0 : groups[j++];
+        bytes[2 * i] = uint8_t(group >> 8);
+        bytes[2 * i + 1] = uint8_t(group);
     }
-    // If the separator is not the first character, assert that parts requiring
-    // an initial character find it.
-    assert(!requireFirst[part] || pos == 0 || input[0] == requireFirst[part]);
-
-    // If the separator was found at pos == 0, the returned string is empty
-    assert(input.size() >= skip[part]);
-    output = input.substr(skip[part], pos - skip[part]);
-    input = pos == std::string::npos ? "" : input.substr(pos + postSkip[part]);
     return true;
 }
 
-void _parseAuthority(URIData& data, const std::string& auth)
+/**
+ * @return the position of the zone id delimiter ("%25" or "%") in an IPv6
+ *         host, or size.
+ */
+size_t _findZone(const char* data, const size_t size)
+{
+    return std::find(data, data + size, '%') - data;
+}
+
+/** @return the begin of the zone id after the delimiter at the given pos. */
+size_t _skipZoneDelimiter(const char* data, const size_t size, size_t pos)
 {
-    const size_t atPos = auth.find_first_of('@');
-    if (atPos != std::string::npos)
-        data.userinfo = auth.substr(0, atPos);
-    const size_t hostPos = atPos == std::string::npos ? 0 : atPos + 1;
-    const size_t colonPos = auth.find_first_of(':', hostPos);
-    if (colonPos != std::string::npos)
+    if (pos + 3 < size && data[pos + 1] == '2' && data[pos + 2] == '5')
+        return pos + 3;
+    return pos + 1;
+}
+
+/** Parse an IPv6 address with an optional, non-empty zone id. */
+bool _parseIPv6Host(const char* data, const size_t size, uint8_t* bytes)
+{
+    const size_t zone = _findZone(data, size);
+    if (!_parseIPv6(data, zone, bytes))
+        return false;
+    return zone == size || _skipZoneDelimiter(data, size, zone) < size;
+}
+
+URI::Address _parseAddress(const URI::Part& host)
+{
+    URI::Address address{URI::Address::NONE, {0}};
+    uint8_t bytes[16];
+    if (std::find(host.begin(), host.end(), ':') != host.end())
     {
-        const std::string port = auth.substr(colonPos + 1);
-        char* end = 0;
-        data.port = ::strtol(port.c_str(), &end, 10);
-        if (port.empty() || end != port.c_str() + port.length())
-            throw std::runtime_error(port + " is not a valid port number");
+        if (_parseIPv6Host(host.data(), host.size(), bytes))
+        {
+            address.family = URI::Address::IPV6;
+            std::copy(bytes, bytes + 16, address.bytes);
+        }
+    }
+    else if (_parseIPv4(host.data(), host.size(), bytes))
+    {
+        address.family = URI::Address::IPV4;
+        std::copy(bytes, bytes + 4, address.bytes);
     }
-    // Works regardless of colonPos == npos
-    data.host = auth.substr(hostPos, colonPos - hostPos);
-    if (data.host.empty())
-        throw std::invalid_argument("");
+    return address;
 }
 
-void _parseQueryMap(URIData& data)
+/** MurmurHash64A by Austin Appleby, public domain. */
+size_t _hash(const char* data, const size_t size)
 {
-    // parse query data into key-value pairs
-    std::string query = data.query;
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    const int r = 47;
+    uint64_t h = 0x8445d61a4e774912ull ^ (size * m);
+
+    const char* const end = data + (size & ~size_t(7));
+    for (; data != end; data += 8)
+    {
+        uint64_t k;
+        ::memcpy(&k, data, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    if (size & 7)
+    {
+        uint64_t k = 0;
+        for (size_t i = size & 7; i > 0; --i)
+            k = (k << 8) | uint8_t(data[i - 1]);
+        h ^= k;
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
 
-    data.queryMap.clear();
-    while (!query.empty())
+/**
+ * @return the given part with percent-encoded unreserved characters decoded
+ *         and upper case hexadecimal digits in all other encodings.
+ */
+std::string _normalizeEncoding(const URI::Part& part)
+{
+    const CharTable& chars = _chars();
+    std::string normalized;
+    normalized.reserve(part.size());
+    for (size_t i = 0; i < part.size(); ++i)
     {
-        const size_t nextPair = query.find('&');
-        if (nextPair == 0)
+        if (part[i] != '%' || i + 2 >= part.size() ||
+            chars.hex(part[i + 1]) < 0 || chars.hex(part[i + 2]) < 0)
         {
-            query = query.substr(1);
+            normalized += part[i];
             continue;
         }
 
-        const std::string pair = query.substr(0, nextPair);
-        if (nextPair == std::string::npos)
-            query.clear();
+        const char c =
+            char(chars.hex(part[i + 1]) * 16 + chars.hex(part[i + 2]));
+        if (chars.isUnreserved(c))
+            normalized += c;
         else
-            query = query.substr(nextPair + 1);
+        {
+            normalized += '%';
+            normalized += char(::toupper(part[i + 1]));
+            normalized += char(::toupper(part[i + 2]));
+        }
+        i += 2;
+    }
+    return normalized;
+}
 
-        const size_t eq = pair.find('=');
-        if (eq == 0) // empty key
-            continue;
-        if (eq == std::string::npos) // empty value
-            data.queryMap[pair] = std::string();
+/** Convert to lower case, except for percent-encoded characters. */
+void _toLower(std::string& str)
+{
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] == '%')
+            i += 2;
         else
-            data.queryMap[pair.substr(0, eq)] = pair.substr(eq + 1);
+            str[i] = char(::tolower(str[i]));
     }
 }
 
-void _toLower(std::string& str)
+uint16_t _getDefaultPort(const std::string& scheme)
 {
-    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    static const std::pair<const char*, uint16_t> ports[] = {
+        {"ftp", 21}, {"http", 80}, {"https", 443}, {"ws", 80}, {"wss", 443}};
+    for (const auto& port : ports)
+        if (scheme == port.first)
+            return port.second;
+    return 0;
 }
 
-class URI
+bool _isFileScheme(const char* scheme, const size_t size)
 {
-public:
-    explicit URI(const std::string& uri)
+    return size == 4 && ::tolower(scheme[0]) == 'f' &&
+           ::tolower(scheme[1]) == 'i' && ::tolower(scheme[2]) == 'l' &&
+           ::tolower(scheme[3]) == 'e';
+}
+
+/**
+ * @return the position of the first of the given (at most four) delimiters, or
+ *         size.
+ */
+size_t _find(const char* data, size_t pos, const size_t size,
+             const char* delimiters)
+{
+#ifdef __SSE2__
+    // compare 16 characters at once against all delimiters
+    const size_t nDelimiters = ::strlen(delimiters);
+    assert(nDelimiters > 0 && nDelimiters <= 4);
+    __m128i masks[4];
+    for (size_t i = 0; i < nDelimiters; ++i)
+        masks[i] = _mm_set1_epi8(delimiters[i]);
+
+    for (; pos + 16 <= size; pos += 16)
     {
-        if (uri.empty())
-            return;
+        const __m128i chars =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i matches = _mm_cmpeq_epi8(chars, masks[0]);
+        for (size_t i = 1; i < nDelimiters; ++i)
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chars, masks[i]));
 
-        try
+        const int bits = _mm_movemask_epi8(matches);
+        if (bits)
+            return pos + __builtin_ctz(bits);
+    }
+#endif
+    for (; pos < size; ++pos)
+        for (const char* delimiter = delimiters; *delimiter; ++delimiter)
+            if (data[pos] == *delimiter)
+                return pos;
+    return size;
+}
+
+/** Append the given string with percent-encoded characters decoded. */
+void _decode(const char* data, const size_t size, std::string& decoded)
+{
+    const CharTable& chars = _chars();
+    decoded.reserve(decoded.size() + size);
+
+    size_t pos = 0;
+    while (pos < size)
+    {
+        const size_t percent = _find(data, pos, size, "%");
+        decoded.append(data + pos, percent - pos);
+        if (percent == size)
+            break;
+
+        const int high = percent + 2 < size ? chars.hex(data[percent + 1]) : -1;
+        const int low = high < 0 ? -1 : chars.hex(data[percent + 2]);
+        if (low < 0) // keep invalid encodings
         {
-            _parseURI(uri);
+            decoded += '%';
+            pos = percent + 1;
+            continue;
         }
-        catch (...)
+        decoded += char(high * 16 + low);
+        pos = percent + 3;
+    }
+}
+
+/** @return true if the given query key equals the key after decoding. */
+bool _isEncoded(const URI::Part& part)
+{
+    return std::find(part.begin(), part.end(), '%') != part.end();
+}
+
+bool _isKey(const URI::Part& encoded, const std::string& key)
+{
+    if (encoded == key)
+        return true;
+    return _isEncoded(encoded) && URI::decode(encoded) == key;
+}
+
+bool _isSameKey(const URI::Part& lhs, const URI::Part& rhs)
+{
+    if (lhs == rhs)
+        return true;
+    return (_isEncoded(lhs) || _isEncoded(rhs)) &&
+           URI::decode(lhs) == URI::decode(rhs);
+}
+
+size_t _hashKey(const URI::Part& encoded)
+{
+    if (!_isEncoded(encoded))
+        return _hash(encoded.data(), encoded.size());
+    const std::string key = URI::decode(encoded);
+    return _hash(key.data(), key.size());
+}
+
+/** @return the number of query index slots, at most half of them used. */
+size_t _countQuerySlots(const URI::Part& query)
+{
+    if (query.empty())
+        return 0;
+    const size_t nPairs = 1 + std::count(query.begin(), query.end(), '&');
+    size_t size = 4;
+    while (size < 2 * nPairs)
+        size *= 2;
+    return size;
+}
+}
+
+URIView::URIView()
+    : _data("")
+    , _scheme{0, 0}
+    , _userinfo{0, 0}
+    , _host{0, 0}
+    , _path{0, 0}
+    , _query{0, 0}
+    , _fragment{0, 0}
+    , _port(0)
+    , _result(URI::Result::SUCCESS)
+{
+}
+
+URIView::URIView(const char* uri, const size_t size)
+    : URIView()
+{
+    _data = uri;
+    const int32_t result = _parse(size);
+    if (result != URI::Result::SUCCESS)
+    {
+        *this = URIView(); // no partial results
+        _result = result;
+    }
+}
+
+URIView::URIView(const std::string& uri)
+    : URIView(uri.data(), uri.size())
+{
+}
+
+int32_t URIView::_parse(const size_t size)
+{
+    // scheme: up to the first "://", unless a '/', '?' or '#' comes first
+    size_t pos = 0;
+    for (size_t i = detail::_find(_data, 0, size, ":/?#");
+         i < size && _data[i] == ':';
+         i = detail::_find(_data, i + 1, size, ":/?#"))
+    {
+        if (i + 2 < size && _data[i + 1] == '/' && _data[i + 2] == '/')
         {
-            throw uri_parse(uri);
+            if (i > 0)
+            {
+                _scheme = Range{0, i};
+                pos = i + 3;
+            }
+            break;
         }
     }
 
-    URIData& getData() { return _uriData; }
-    const URIData& getData() const { return _uriData; }
-private:
-    URIData _uriData;
+    if (_scheme.size > 0)
+    {
+        if (!::isalpha(_data[0]))
+            return URI::Result::INVALID_SCHEME;
+        for (size_t i = 1; i < _scheme.size; ++i)
+            if (!detail::_isSchemeChar(_data[i]))
+                return URI::Result::INVALID_SCHEME;
+    }
 
-    void _parseURI(std::string input)
+    // authority, except for file URIs: from http://en.wikipedia.org/wiki/
+    // File_URI_scheme: "file:///foo.txt" is okay, while "file://foo.txt" is
+    // not, although some interpreters manage to handle the latter. We are
+    // "some".
+    if (_scheme.size > 0 && !detail::_isFileScheme(_data, _scheme.size))
     {
-        URIPart part = SCHEME;
-        while (!input.empty())
+        const size_t end = detail::_find(_data, pos, size, "/?#");
+        if (end > pos)
         {
-            switch (part)
+            size_t hostPos = pos;
+            const size_t at = detail::_find(_data, pos, end, "@");
+            if (at < end)
             {
-            case SCHEME:
-                _parseURIPart(input, part, _uriData.scheme);
-                _toLower(_uriData.scheme);
-                if (!_uriData.scheme.empty() &&
-                    (!isalpha(_uriData.scheme[0]) ||
-                     _uriData.scheme.find_first_not_of(
-                         "abcdefghijlkmnopqrstuvwxyz0123456789+-.", 1) !=
-                         std::string::npos))
+                _userinfo = Range{pos, at - pos};
+                hostPos = at + 1;
+            }
+
+            size_t colon;
+            if (hostPos < end && _data[hostPos] == '[') // IP literal
+            {
+                const size_t close = detail::_find(_data, hostPos, end, "]");
+                colon = close + 1;
+                uint8_t bytes[16];
+                if (close == end ||
+                    !detail::_parseIPv6Host(_data + hostPos + 1,
+                                            close - hostPos - 1, bytes) ||
+                    (colon < end && _data[colon] != ':'))
                 {
-                    throw std::invalid_argument("");
+                    return URI::Result::INVALID_HOST;
                 }
-                part = _uriData.scheme == "file" || _uriData.scheme.empty()
-                           ? PATH
-                           : AUTHORITY;
-                // from http://en.wikipedia.org/wiki/File_URI_scheme:
-                //  "file:///foo.txt" is okay, while "file://foo.txt"
-                // is not, although some interpreters manage to handle
-                // the latter. We are "some".
-                break;
-            case AUTHORITY:
+                _host = Range{hostPos + 1, close - hostPos - 1};
+            }
+            else
             {
-                std::string authority;
-                _parseURIPart(input, part, authority);
-                if (!authority.empty())
-                    _parseAuthority(_uriData, authority);
-                part = PATH;
-                break;
+                colon = detail::_find(_data, hostPos, end, ":");
+                _host = Range{hostPos, colon - hostPos};
+                if (_host.size == 0)
+                    return URI::Result::EMPTY_HOST;
             }
-            case PATH:
-                _parseURIPart(input, part, _uriData.path);
-                part = QUERY;
-                break;
-            case QUERY:
-                _parseURIPart(input, part, _uriData.query);
-                _parseQueryMap(_uriData);
-                part = FRAGMENT;
-                break;
-            case FRAGMENT:
-                _parseURIPart(input, part, _uriData.fragment);
-                break;
+
+            if (colon < end)
+            {
+                if (colon + 1 == end)
+                    return URI::Result::INVALID_PORT;
+
+                uint32_t port = 0;
+                for (size_t i = colon + 1; i < end; ++i)
+                {
+                    const char c = _data[i];
+                    if (c < '0' || c > '9')
+                        return URI::Result::INVALID_PORT;
+                    port = port * 10 + uint32_t(c - '0');
+                    if (port > 65535)
+                        return URI::Result::INVALID_PORT;
+                }
+                _port = uint16_t(port);
             }
+            pos = end;
         }
     }
-};
+
+    const size_t pathEnd = detail::_find(_data, pos, size, "?#");
+    _path = Range{pos, pathEnd - pos};
+    pos = pathEnd;
+
+    if (pos < size && _data[pos] == '?')
+    {
+        const size_t queryEnd = detail::_find(_data, pos + 1, size, "#");
+        _query = Range{pos + 1, queryEnd - pos - 1};
+        pos = queryEnd;
+    }
+
+    if (pos < size) // '#'
+        _fragment = Range{pos + 1, size - pos - 1};
+    return URI::Result::SUCCESS;
+}
+
+void URIColumns::parse(const std::string* uris, const size_t count)
+{
+    std::vector<Range>* columns[] = {&schemes, &userinfos, &hosts, &paths,
+                                     &queries, &fragments};
+    for (std::vector<Range>* column : columns)
+        column->resize(count);
+    ports.resize(count);
+    results.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const std::string& uri = uris[i];
+        const URIView view(uri);
+        const auto range = [&uri](const URIView::Part& part) {
+            return Range{uint32_t(part.data() - uri.data()),
+                         uint32_t(part.size())};
+        };
+
+        results[i] = view.getResult().getCode();
+        if (!view.isValid())
+        {
+            for (std::vector<Range>* column : columns)
+                (*column)[i] = Range{0, 0};
+            ports[i] = 0;
+            continue;
+        }
+
+        schemes[i] = range(view.getScheme());
+        userinfos[i] = range(view.getUserinfo());
+        hosts[i] = range(view.getHost());
+        ports[i] = view.getPort();
+        paths[i] = range(view.getPath());
+        queries[i] = range(view.getQuery());
+        fragments[i] = range(view.getFragment());
+    }
+}
+
+void URIColumns::parse(const std::vector<std::string>& uris)
+{
+    parse(uris.data(), uris.size());
 }
 
 URI::URI()
-    : _impl(new detail::URI(std::string()))
+    : _ends{0, 0, 0, 0, 0, 0}
+    , _stringEnd(0)
+    , _port(0)
+    , _hash(detail::_hash(nullptr, 0))
+    , _address{Address::NONE, {0}}
 {
 }
 
 URI::URI(const std::string& uri)
-    : _impl(new detail::URI(uri))
+    : URI()
 {
+    if (uri.empty())
+        return;
+
+    const URIView view(uri);
+    if (!view.isValid())
+        throw detail::uri_parse(uri, view.getResult());
+    _assign(view);
 }
 
 URI::URI(const char* uri)
-    : _impl(new detail::URI(std::string(uri)))
+    : URI(std::string(uri))
+{
+}
+
+URI::URI(const URIView& view)
+    : URI()
 {
+    if (!view.isValid())
+        throw detail::uri_parse("invalid URIView", view.getResult());
+    _assign(view);
 }
 
-URI::URI(const URI& from)
-    : _impl(new detail::URI(*from._impl))
+URI::Result URI::tryParse(const std::string& input, URI& uri)
 {
+    const URIView view(input);
+    if (view.isValid())
+        uri._assign(view);
+    return view.getResult();
 }
 
-servus::URI::~URI()
+URI::URI(const URI& from) = default;
+
+URI::URI(URI&& from) noexcept : URI()
 {
-    delete _impl;
+    *this = std::move(from);
 }
 
-URI& URI::operator=(const URI& rhs)
+URI::~URI()
+{
+}
+
+URI& URI::operator=(const URI& rhs) = default;
+
+URI& URI::operator=(URI&& rhs) noexcept
 {
     if (this != &rhs)
-        *_impl = *rhs._impl;
+    {
+        _data = std::move(rhs._data);
+        std::copy(rhs._ends, rhs._ends + NUM_PARTS, _ends);
+        _stringEnd = rhs._stringEnd;
+        _port = rhs._port;
+        _hash = rhs._hash;
+        _address = rhs._address;
+        rhs._data.clear();
+        std::fill(rhs._ends, rhs._ends + NUM_PARTS, 0);
+        rhs._stringEnd = 0;
+        rhs._port = 0;
+        rhs._hash = detail::_hash(nullptr, 0);
+        rhs._address = Address{Address::NONE, {0}};
+    }
     return *this;
 }
 
-bool URI::operator==(const URI& rhs) const
+void URI::_assign(const URIView& view)
 {
-    return this == &rhs || (_impl->getData() == rhs._impl->getData());
+    const Part parts[NUM_PARTS] = {view.getScheme(), view.getUserinfo(),
+                                   view.getHost(),   view.getPath(),
+                                   view.getQuery(),  view.getFragment()};
+    _assign(parts, view.getPort());
 }
 
-bool URI::operator!=(const URI& rhs) const
+void URI::_assign(const Part* parts, const uint16_t port)
 {
-    return !(*this == rhs);
+    size_t size = 0;
+    for (size_t i = 0; i < NUM_PARTS; ++i)
+        size += parts[i].size();
+
+    _data.clear();
+    _data.reserve(2 * size + 14 + // for the string form, see _update()
+                  detail::_countQuerySlots(parts[QUERY]) * sizeof(QuerySlot));
+    for (size_t i = 0; i < NUM_PARTS; ++i)
+    {
+        _data.append(parts[i].data(), parts[i].size());
+        _ends[i] = uint32_t(_data.size());
+    }
+    std::transform(_data.begin(), _data.begin() + _ends[SCHEME], _data.begin(),
+                   ::tolower);
+    _port = port;
+    _update();
 }
 
-const std::string& URI::getScheme() const
+void URI::_replace(const PartIndex index, const size_t pos, const size_t size,
+                   const std::string& str)
 {
-    return _impl->getData().scheme;
+    _data.replace(_begin(index) + pos, size, str);
+    const uint32_t delta = uint32_t(str.size() - size); // wraps if shrinking
+    for (size_t i = index; i < NUM_PARTS; ++i)
+        _ends[i] += delta;
+    _update();
 }
 
-const std::string& URI::getHost() const
+void URI::_update()
 {
-    return _impl->getData().host;
+    // the string form needs at most 14 separator characters; reserve it and
+    // the query index before taking the parts, which stay valid while
+    // appending
+    const size_t begin = _ends[FRAGMENT];
+    const size_t nSlots = detail::_countQuerySlots(_part(QUERY));
+    const size_t capacity = 2 * begin + 14 + nSlots * sizeof(QuerySlot);
+    _data.resize(begin);
+    if (_data.capacity() < capacity)
+        _data.reserve(capacity);
+
+    const Part scheme = getScheme();
+    const Part userinfo = getUserinfo();
+    const Part host = getHost();
+    const Part path = getPath();
+    const Part query = getQuery();
+    const Part fragment = getFragment();
+    _address = detail::_parseAddress(host);
+
+    if (!scheme.empty())
+        _data.append(scheme.data(), scheme.size()).append("://");
+    // A valid URI can't contain the user info or port number alone, so if
+    // the host name is empty the other two field are simply ignored.
+    if (!host.empty())
+    {
+        if (!userinfo.empty())
+            _data.append(userinfo.data(), userinfo.size()).append(1, '@');
+        if (_address.family == Address::IPV6)
+            _data.append(1, '[')
+                .append(host.data(), host.size())
+                .append(1, ']');
+        else
+            _data.append(host.data(), host.size());
+        if (_port)
+        {
+            char port[5];
+            size_t size = 0;
+            for (uint16_t value = _port; value; value /= 10)
+                port[size++] = char('0' + value % 10);
+            _data.append(1, ':');
+            while (size)
+                _data.append(1, port[--size]);
+        }
+    }
+    _data.append(path.data(), path.size());
+    if (!query.empty())
+        _data.append(1, '?').append(query.data(), query.size());
+    if (!fragment.empty())
+        _data.append(1, '#').append(fragment.data(), fragment.size());
+
+    _stringEnd = uint32_t(_data.size());
+    _hash = detail::_hash(_data.data() + begin, _stringEnd - begin);
+    _indexQuery(nSlots);
 }
 
-std::string URI::getAuthority() const
+void URI::_indexQuery(const size_t nSlots)
 {
-    std::stringstream authority;
-    if (!_impl->getData().userinfo.empty())
-        authority << _impl->getData().userinfo << "@";
-    // IPv6 IPs are not considered.
-    authority << _impl->getData().host;
-    if (_impl->getData().port)
-        authority << ":" << _impl->getData().port;
-    return authority.str();
+    if (nSlots == 0)
+        return;
+    _data.append(nSlots * sizeof(QuerySlot), '\0');
+
+    const Part query = getQuery();
+    const size_t mask = nSlots - 1;
+    const ConstKVIter end = queryEnd();
+    for (ConstKVIter i = queryBegin(); i != end; ++i)
+    {
+        const size_t hash = detail::_hashKey(i->first);
+        const uint32_t tag = hash & 0xffffffffu;
+        for (size_t j = hash & mask;; j = (j + 1) & mask)
+        {
+            const QuerySlot slot = _getQuerySlot(j);
+            if (slot.pos == 0 ||
+                (slot.hash == tag &&
+                 detail::_isSameKey(ConstKVIter(query.data(), query.size(),
+                                                slot.pos - 1)->first,
+                                    i->first)))
+            {
+                // the last pair with the key wins
+                _setQuerySlot(j, QuerySlot{tag, uint32_t(i._pos + 1)});
+                break;
+            }
+        }
+    }
 }
 
-uint16_t URI::getPort() const
+// The index follows the string form at any alignment, so slots are copied
+URI::QuerySlot URI::_getQuerySlot(const size_t i) const
 {
-    return _impl->getData().port;
+    QuerySlot slot;
+    ::memcpy(&slot, _data.data() + _stringEnd + i * sizeof(QuerySlot),
+             sizeof(QuerySlot));
+    return slot;
 }
 
-const std::string& URI::getUserinfo() const
+void URI::_setQuerySlot(const size_t i, const QuerySlot& slot)
 {
-    return _impl->getData().userinfo;
+    ::memcpy(&_data[_stringEnd + i * sizeof(QuerySlot)], &slot,
+             sizeof(QuerySlot));
 }
 
-const std::string& URI::getPath() const
+void URI::normalize()
 {
-    return _impl->getData().path;
+    std::string parts[NUM_PARTS];
+    for (size_t i = 0; i < NUM_PARTS; ++i)
+        parts[i] = detail::_normalizeEncoding(_part(PartIndex(i)));
+    detail::_toLower(parts[SCHEME]);
+    std::string& host = parts[HOST];
+    if (_address.family == Address::IPV6) // keep the case of the zone id
+        std::transform(host.begin(),
+                       host.begin() +
+                           detail::_findZone(host.data(), host.size()),
+                       host.begin(), ::tolower);
+    else
+        detail::_toLower(host);
+
+    Part views[NUM_PARTS];
+    for (size_t i = 0; i < NUM_PARTS; ++i)
+        views[i] = Part(parts[i].data(), parts[i].size());
+    const uint16_t defaultPort = detail::_getDefaultPort(parts[SCHEME]);
+    _assign(views, _port == defaultPort ? 0 : _port);
 }
 
-const std::string& URI::getQuery() const
+std::string URI::Result::getString() const
 {
-    return _impl->getData().query;
+    switch (getCode())
+    {
+    case INVALID_SCHEME:
+        return "invalid scheme";
+    case EMPTY_HOST:
+        return "empty host";
+    case INVALID_PORT:
+        return "invalid port";
+    case INVALID_HOST:
+        return "invalid host";
+    default:
+        return servus::Result::getString();
+    }
 }
 
-const std::string& URI::getFragment() const
+bool URI::operator==(const URI& rhs) const
 {
-    return _impl->getData().fragment;
+    // the string form omits the user info and port without a host
+    return this == &rhs ||
+           (_hash == rhs._hash && _port == rhs._port &&
+            getString() == rhs.getString() &&
+            getUserinfo() == rhs.getUserinfo());
+}
+
+bool URI::operator!=(const URI& rhs) const
+{
+    return !(*this == rhs);
+}
+
+std::string URI::getAuthority() const
+{
+    std::string authority;
+    if (!getUserinfo().empty())
+        authority.append(getUserinfo().data(), getUserinfo().size())
+            .append(1, '@');
+    if (_address.family == Address::IPV6)
+        authority.append(1, '[')
+            .append(getHost().data(), getHost().size())
+            .append(1, ']');
+    else
+        authority.append(getHost().data(), getHost().size());
+    if (_port)
+        authority.append(1, ':').append(std::to_string(unsigned(_port)));
+    return authority;
 }
 
 void URI::setScheme(const std::string& scheme)
 {
-    _impl->getData().scheme = scheme;
+    _replace(SCHEME, 0, getScheme().size(), scheme);
 }
 
 void URI::setUserInfo(const std::string& userinfo)
 {
-    _impl->getData().userinfo = userinfo;
+    _replace(USERINFO, 0, getUserinfo().size(), userinfo);
 }
 
 void URI::setHost(const std::string& host)
 {
-    _impl->getData().host = host;
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+        _replace(HOST, 0, getHost().size(), host.substr(1, host.size() - 2));
+    else
+        _replace(HOST, 0, getHost().size(), host);
+}
+
+URI::Part URI::getZoneID() const
+{
+    if (_address.family != Address::IPV6)
+        return Part();
+
+    const Part host = getHost();
+    const size_t zone = detail::_findZone(host.data(), host.size());
+    if (zone == host.size())
+        return Part();
+    const size_t begin =
+        detail::_skipZoneDelimiter(host.data(), host.size(), zone);
+    return Part(host.data() + begin, host.size() - begin);
 }
 
 void URI::setPort(const uint16_t port)
 {
-    _impl->getData().port = port;
+    _port = port;
+    _update();
 }
 
 void URI::setPath(const std::string& path)
 {
-    _impl->getData().path = path;
+    _replace(PATH, 0, getPath().size(), path);
 }
 
 void URI::setQuery(const std::string& query)
 {
-    URIData& data = _impl->getData();
-    data.query = query;
-    detail::_parseQueryMap(data);
+    _replace(QUERY, 0, getQuery().size(), query);
 }
 
 void URI::setFragment(const std::string& fragment)
 {
-    _impl->getData().fragment = fragment;
+    _replace(FRAGMENT, 0, getFragment().size(), fragment);
+}
+
+std::string URI::encode(const std::string& str, const Component component)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    const detail::CharTable& chars = detail::_chars();
+
+    std::string encoded;
+    encoded.reserve(str.size());
+    size_t begin = 0; // of the current run of allowed characters
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        const uint8_t c = uint8_t(str[i]);
+        if (chars.isAllowed(char(c), component))
+            continue;
+
+        encoded.append(str, begin, i - begin);
+        encoded += '%';
+        encoded += digits[c >> 4];
+        encoded += digits[c & 0xf];
+        begin = i + 1;
+    }
+    encoded.append(str, begin, std::string::npos);
+    return encoded;
+}
+
+std::string URI::decode(const Part& str)
+{
+    std::string decoded;
+    detail::_decode(str.data(), str.size(), decoded);
+    return decoded;
 }
 
 URI::ConstKVIter URI::queryBegin() const
 {
-    return _impl->getData().queryMap.begin();
+    const Part query = getQuery();
+    return ConstKVIter(query.data(), query.size(), 0);
 }
 
 URI::ConstKVIter URI::queryEnd() const
 {
-    return _impl->getData().queryMap.end();
+    const Part query = getQuery();
+    return ConstKVIter(query.data(), query.size(), query.size());
 }
 
 URI::ConstKVIter URI::findQuery(const std::string& key) const
 {
-    return _impl->getData().queryMap.find(key);
+    const size_t nSlots = _getNumQuerySlots();
+    if (nSlots == 0)
+        return queryEnd();
+
+    const Part query = getQuery();
+    const size_t hash = detail::_hash(key.data(), key.size());
+    const uint32_t tag = hash & 0xffffffffu;
+    const size_t mask = nSlots - 1;
+    for (size_t j = hash & mask;; j = (j + 1) & mask)
+    {
+        const QuerySlot slot = _getQuerySlot(j);
+        if (slot.pos == 0)
+            break;
+        if (slot.hash != tag)
+            continue;
+        const ConstKVIter i(query.data(), query.size(), slot.pos - 1);
+        if (detail::_isKey(i->first, key))
+            return i;
+    }
+    return queryEnd();
 }
 
 void URI::addQuery(const std::string& key, const std::string& value)
 {
-    URIData& data = _impl->getData();
-
-    data.queryMap[key] = value;
-    data.fragment.clear();
+    setFragment(std::string());
+    const size_t size = getQuery().size();
+    _replace(QUERY, size, 0,
+             (size ? "&" : "") + encode(key, COMPONENT_QUERY) + '=' +
+                 encode(value, COMPONENT_QUERY));
+}
 
-    // Rebuild fragment string
-    data.query.clear();
-    for (URI::ConstKVIter i = queryBegin(); i != queryEnd(); ++i)
+void URI::ConstKVIter::_seek(size_t pos)
+{
+    while (pos < _size)
     {
-        if (data.query.empty())
-            data.query = i->first + "=" + i->second;
-        else
-            data.query += std::string("&") + i->first + "=" + i->second;
+        const char* begin = _query + pos;
+        const char* end = std::find(begin, _query + _size, '&');
+        const char* eq = std::find(begin, end, '=');
+        if (end == begin || eq == begin) // empty pair or key
+        {
+            pos = end - _query + 1;
+            continue;
+        }
+
+        _pos = pos;
+        _end = end - _query;
+        _pair.first = Part(begin, eq - begin);
+        _pair.second = eq == end ? Part() : Part(eq + 1, end - eq - 1);
+        return;
     }
+    _pos = _end = _size;
+    _pair = KVPair();
 }
 }
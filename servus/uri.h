@@ -21,18 +21,18 @@
 #define SERVUS_URI_H
 
 #include <servus/api.h>
+#include <servus/result.h>
 #include <servus/types.h>
 
-#include <map>
+#include <algorithm>
+#include <functional>
+#include <iterator>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 namespace servus
 {
-namespace detail
-{
-class URI;
-}
-
 /**
  * The URI class parses the given uri using the generic syntax from RFC3986 and
  * RFC6570
@@ -54,58 +54,282 @@ class URI;
  * Queries are parsed into key-value pairs and can be accessed using
  * findQuery(), queryBegin() and queryEnd().
  *
+ * All parts, the string form and the index of the query keys are stored in one
+ * string buffer, so that copying an URI allocates at most once, and moving it
+ * does not allocate.
+ * The getters return views into this buffer, which are valid until the URI is
+ * modified or destroyed. The string form and its hash are updated by every
+ * modification, which makes printing, comparing and hashing URIs cheap.
+ *
  * We enforce schemas to have the separator "://", not only ":" which is enough
  * for the RFC specification.
  *
+ * IPv6 hosts are enclosed in brackets, optionally with a zone id as in
+ * "tcp://[fe80::1%25eth0]:4242" (RFC6874), where the zone id delimiter may
+ * also be a plain "%". The host is returned without the brackets, and the
+ * binary address of numeric hosts is available using getAddress().
+ *
  * Example: @include tests/uri.cpp
  */
 class URI
 {
 public:
-    typedef std::map<std::string, std::string> KVMap;
-    typedef KVMap::const_iterator ConstKVIter;
+    /** A part of an URI string, not null-terminated. @version 1.6 */
+    class Part
+    {
+    public:
+        Part()
+            : _data("")
+            , _size(0)
+        {
+        }
+        Part(const char* data, const size_t size)
+            : _data(data)
+            , _size(size)
+        {
+        }
+
+        const char* data() const { return _data; }
+        size_t size() const { return _size; }
+        size_t length() const { return _size; }
+        bool empty() const { return _size == 0; }
+        const char* begin() const { return _data; }
+        const char* end() const { return _data + _size; }
+        char operator[](const size_t i) const { return _data[i]; }
+        std::string str() const { return std::string(_data, _size); }
+        operator std::string() const { return str(); }
+
+        /** @return the position of the given string, or std::string::npos. */
+        size_t find(const std::string& str, const size_t pos = 0) const
+        {
+            if (pos > _size)
+                return std::string::npos;
+            const char* i = std::search(begin() + pos, end(), str.begin(),
+                                        str.end());
+            return i == end() && !str.empty() ? std::string::npos
+                                              : size_t(i - _data);
+        }
+
+        bool operator==(const Part& rhs) const
+        {
+            return _size == rhs._size && std::equal(begin(), end(), rhs._data);
+        }
+        bool operator==(const std::string& rhs) const
+        {
+            return *this == Part(rhs.data(), rhs.size());
+        }
+        bool operator==(const char* rhs) const
+        {
+            return *this == Part(rhs, std::char_traits<char>::length(rhs));
+        }
+        template <class T>
+        bool operator!=(const T& rhs) const
+        {
+            return !(*this == rhs);
+        }
+
+    private:
+        const char* _data;
+        size_t _size;
+    };
+
+    /** A query key-value pair. */
+    typedef std::pair<Part, Part> KVPair;
+
+    /** Iterates the query key-value pairs in order, keys may repeat. */
+    class ConstKVIter
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef KVPair value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const KVPair* pointer;
+        typedef const KVPair& reference;
+
+        ConstKVIter()
+            : _query(nullptr)
+            , _size(0)
+            , _pos(0)
+            , _end(0)
+        {
+        }
+
+        const KVPair& operator*() const { return _pair; }
+        const KVPair* operator->() const { return &_pair; }
+        ConstKVIter& operator++()
+        {
+            _seek(_end + 1);
+            return *this;
+        }
+        ConstKVIter operator++(int)
+        {
+            const ConstKVIter i(*this);
+            ++*this;
+            return i;
+        }
+        bool operator==(const ConstKVIter& rhs) const
+        {
+            return _query == rhs._query && _pos == rhs._pos;
+        }
+        bool operator!=(const ConstKVIter& rhs) const
+        {
+            return !(*this == rhs);
+        }
+
+    private:
+        friend class URI;
+        const char* _query;
+        size_t _size;
+        size_t _pos; //!< begin of the current pair, _size at the end
+        size_t _end; //!< end of the current pair
+        KVPair _pair;
+
+        ConstKVIter(const char* query, const size_t size, const size_t pos)
+            : _query(query)
+            , _size(size)
+        {
+            _seek(pos);
+        }
+
+        /** Move to the first non-empty pair at or after pos. */
+        SERVUS_API void _seek(size_t pos);
+    };
+
+    /** The result of parsing an URI string. @version 1.6 */
+    class Result : public servus::Result
+    {
+    public:
+        explicit Result(const int32_t code)
+            : servus::Result(code)
+        {
+        }
+        virtual ~Result() {}
+        SERVUS_API std::string getString() const override;
+
+        /** The scheme contains invalid characters. */
+        static const int32_t INVALID_SCHEME = -1;
+        /** The authority has no host. */
+        static const int32_t EMPTY_HOST = -2;
+        /** The port is empty, not a number or out of range. */
+        static const int32_t INVALID_PORT = -3;
+        /** The host is not a valid IPv6 address in brackets. */
+        static const int32_t INVALID_HOST = -4;
+    };
+
+    /** The binary address of a numeric host. @version 1.6 */
+    struct Address
+    {
+        enum Family
+        {
+            NONE, //!< not a numeric host
+            IPV4,
+            IPV6
+        };
+
+        Family family;
+        uint8_t bytes[16]; //!< network byte order, four bytes used for IPv4
+    };
+
+    /** The components of an URI, for percent-encoding. @version 1.6 */
+    enum Component
+    {
+        COMPONENT_USERINFO,
+        COMPONENT_HOST,
+        COMPONENT_PATH,
+        COMPONENT_QUERY, //!< query keys and values
+        COMPONENT_FRAGMENT
+    };
 
     /** Construct an empty URI. */
     SERVUS_API URI();
 
     /**
      * @param uri URI string to parse.
-     * @throw std::exception for incomplete URIs, and std::invalid_argument
-     *        if the port is not a number.
+     * @throw std::exception for invalid URIs, see tryParse() for a
+     *        non-throwing alternative.
      */
     SERVUS_API explicit URI(const std::string& uri);
 
     /** @overload URI::URI( const std::string& ) */
     SERVUS_API explicit URI(const char* uri);
 
+    /**
+     * Construct an URI from the parts of the given view.
+     * @throw std::exception if the view is not a valid URI.
+     * @version 1.6
+     */
+    SERVUS_API explicit URI(const URIView& view);
+
+    /**
+     * Parse the given URI string without throwing an exception.
+     *
+     * @param input URI string to parse.
+     * @param uri set to the parsed URI on success, unchanged otherwise.
+     * @return the success of the operation, naming the invalid part on failure.
+     * @version 1.6
+     */
+    SERVUS_API static Result tryParse(const std::string& input, URI& uri);
+
     /** Copy-construct an URI. */
     SERVUS_API URI(const URI& from);
 
+    /** Move-construct an URI, leaving the source empty. @version 1.6 */
+    SERVUS_API URI(URI&& from) noexcept;
+
     SERVUS_API ~URI();
 
     /** Assign the data from another URI. */
     SERVUS_API URI& operator=(const URI& rhs);
 
-    /** Equals operator */
+    /** Move the data from another URI, leaving it empty. @version 1.6 */
+    SERVUS_API URI& operator=(URI&& rhs) noexcept;
+
+    /** Equals operator, the scheme is compared since version 1.6. */
     SERVUS_API bool operator==(const URI& rhs) const;
 
     /** Not equals operator */
     SERVUS_API bool operator!=(const URI& rhs) const;
 
-    /** @name Getters for uri data */
+    /** @name Getters for uri data, valid until the URI is modified */
     //@{
-    SERVUS_API const std::string& getScheme() const;
-    SERVUS_API const std::string& getUserinfo() const;
-    SERVUS_API uint16_t getPort() const;
-    SERVUS_API const std::string& getHost() const;
+    Part getScheme() const { return _part(SCHEME); }
+    Part getUserinfo() const { return _part(USERINFO); }
+    uint16_t getPort() const { return _port; }
+    Part getHost() const { return _part(HOST); }
     /** Return the compound authority part of the URI.
 
         User info added only if not empty, port number added only if it's
         different from 0. */
     SERVUS_API std::string getAuthority() const;
-    SERVUS_API const std::string& getPath() const;
-    SERVUS_API const std::string& getQuery() const;
-    SERVUS_API const std::string& getFragment() const;
+    Part getPath() const { return _part(PATH); }
+    Part getQuery() const { return _part(QUERY); }
+    Part getFragment() const { return _part(FRAGMENT); }
+
+    /** @return the string form of the URI, see operator<<. @version 1.6 */
+    Part getString() const
+    {
+        return Part(_data.data() + _ends[FRAGMENT],
+                    _stringEnd - _ends[FRAGMENT]);
+    }
+
+    /** @return the hash of the string form. @version 1.6 */
+    size_t getHash() const { return _hash; }
+
+    /** @return the binary address of an IPv4 or IPv6 host. @version 1.6 */
+    const Address& getAddress() const { return _address; }
+
+    /** @return the zone id of an IPv6 host, e.g., "eth0". @version 1.6 */
+    SERVUS_API Part getZoneID() const;
+    //@}
+
+    /** @name Getters for percent-decoded uri data, decoded on each call */
+    //@{
+    /** @version 1.6 */
+    std::string getDecodedUserinfo() const { return decode(getUserinfo()); }
+    /** @version 1.6 */
+    std::string getDecodedPath() const { return decode(getPath()); }
+    /** @version 1.6 */
+    std::string getDecodedFragment() const { return decode(getFragment()); }
     //@}
 
     /** @name Setters for uri data. */
@@ -122,7 +346,8 @@ public:
     /** @name Access to key-value data in query. */
     //@{
     /**
-     * @return a const iterator to the beginning of the query map.
+     * @return a const iterator to the first query key-value pair. Pairs are
+     *         iterated in the order of the query string.
      */
     SERVUS_API ConstKVIter queryBegin() const;
 
@@ -132,48 +357,262 @@ public:
     SERVUS_API ConstKVIter queryEnd() const;
 
     /**
-     * @return a const iterator to the given key, or queryEnd().
+     * @return a const iterator to the last pair with the given key, or
+     *         queryEnd(). Keys are compared percent-decoded, use decode() to
+     *         decode the value.
      */
     SERVUS_API ConstKVIter findQuery(const std::string& key) const;
 
-    /** Add a key-value pair to the query. */
+    /**
+     * Add a key-value pair to the query.
+     *
+     * The pair is appended to the query string, percent-encoded since version
+     * 1.6. An existing pair with the same key is kept, but findQuery() returns
+     * the new one.
+     */
     SERVUS_API void addQuery(const std::string& key, const std::string& value);
     //@}
 
+    /**
+     * @return the given string with all characters which are not allowed in
+     *         the given component percent-encoded.
+     * @version 1.6
+     */
+    SERVUS_API static std::string encode(const std::string& str,
+                                         Component component);
+
+    /**
+     * @return the given string with all percent-encoded characters decoded.
+     *         Invalid encodings are kept as they are.
+     * @version 1.6
+     */
+    SERVUS_API static std::string decode(const Part& str);
+
+    /** @overload */
+    static std::string decode(const std::string& str)
+    {
+        return decode(Part(str.data(), str.size()));
+    }
+
+    /**
+     * Normalize the URI as described in RFC3986, section 6.2.2 and 6.2.3.
+     *
+     * The scheme and host are converted to lower case, the hexadecimal digits
+     * of percent-encoded characters to upper case, and percent-encoded
+     * unreserved characters are decoded. The port is removed if it is the
+     * default port of the scheme. Equivalent URIs are equal after
+     * normalization, e.g., for use as keys in hash maps.
+     * @version 1.6
+     */
+    SERVUS_API void normalize();
+
 private:
-    detail::URI* const _impl;
+    enum PartIndex
+    {
+        SCHEME,
+        USERINFO,
+        HOST,
+        PATH,
+        QUERY,
+        FRAGMENT,
+        NUM_PARTS
+    };
+
+    std::string _data;         //!< all parts, the string form, the query index
+    uint32_t _ends[NUM_PARTS]; //!< end of each part in _data
+    uint32_t _stringEnd;       //!< end of the string form in _data
+    uint16_t _port;
+    size_t _hash; //!< of the string form
+    Address _address;
+
+    /** A slot of the open addressing query index behind the string form. */
+    struct QuerySlot
+    {
+        uint32_t hash; //!< lower bits of the hash of the decoded key
+        uint32_t pos;  //!< of the last pair with the key in the query, plus one
+    };
+
+    size_t _begin(const PartIndex i) const { return i ? _ends[i - 1] : 0; }
+    Part _part(const PartIndex i) const
+    {
+        return Part(_data.data() + _begin(i), _ends[i] - _begin(i));
+    }
+    void _assign(const URIView& view);
+    void _assign(const Part* parts, uint16_t port);
+    void _replace(PartIndex i, size_t pos, size_t size, const std::string& str);
+    void _update();
+    void _indexQuery(size_t nSlots);
+    size_t _getNumQuerySlots() const
+    {
+        return (_data.size() - _stringEnd) / sizeof(QuerySlot);
+    }
+    QuerySlot _getQuerySlot(size_t i) const;
+    void _setQuerySlot(size_t i, const QuerySlot& slot);
 };
 
-inline std::ostream& operator<<(std::ostream& os, const URI& uri)
+/**
+ * A non-owning view of the parts of an URI string.
+ *
+ * The string is parsed in a single pass into the locations of its parts,
+ * without copying or allocating memory. The viewed string has to outlive the
+ * view. The parts are not normalized, i.e., the scheme keeps its case. The
+ * syntax is the same as for URI, see there.
+ *
+ * Example: @include tests/uri.cpp
+ * @version 1.6
+ */
+class URIView
 {
-    if (!uri.getScheme().empty())
-        os << uri.getScheme() << "://";
-    // A valid URI can't contain the user info or port number alone, so if
-    // the host name is empty the other two field are simply ignored.
-    if (!uri.getHost().empty())
+public:
+    /** A part of the viewed string. */
+    typedef URI::Part Part;
+
+    /** Construct an empty view. */
+    SERVUS_API URIView();
+
+    /** Parse the given URI string of the given size. */
+    SERVUS_API URIView(const char* uri, size_t size);
+
+    /** Parse the given URI string, which has to outlive the view. */
+    SERVUS_API explicit URIView(const std::string& uri);
+
+    /** @return false if the viewed string is not a valid URI. */
+    bool isValid() const { return _result == URI::Result::SUCCESS; }
+
+    /** @return the parse result, naming the invalid part on failure. */
+    URI::Result getResult() const { return URI::Result(_result); }
+
+    /** @name Getters for uri data, empty for invalid URIs */
+    //@{
+    Part getScheme() const { return _part(_scheme); }
+    Part getUserinfo() const { return _part(_userinfo); }
+    uint16_t getPort() const { return _port; }
+    Part getHost() const { return _part(_host); }
+    Part getPath() const { return _part(_path); }
+    Part getQuery() const { return _part(_query); }
+    Part getFragment() const { return _part(_fragment); }
+    //@}
+
+private:
+    struct Range
+    {
+        size_t begin;
+        size_t size;
+    };
+
+    const char* _data;
+    Range _scheme;
+    Range _userinfo;
+    Range _host;
+    Range _path;
+    Range _query;
+    Range _fragment;
+    uint16_t _port;
+    int32_t _result;
+
+    Part _part(const Range& range) const
     {
-        if (!uri.getUserinfo().empty())
-            os << uri.getUserinfo() << "@";
-        os << uri.getHost();
-        if (uri.getPort())
-            os << ':' << uri.getPort();
+        return Part(_data + range.begin, range.size);
     }
-    os << uri.getPath();
-    if (!uri.getQuery().empty())
-        os << '?' << uri.getQuery();
-    if (!uri.getFragment().empty())
-        os << '#' << uri.getFragment();
-    return os;
+    int32_t _parse(size_t size);
+};
+
+/**
+ * The parts of many URI strings, stored in columns for bulk parsing.
+ *
+ * Each part is stored as the location within its URI string, and each column
+ * is one contiguous array. Invalid URIs are reported by their result code
+ * instead of throwing an exception. Parsing a new batch reuses the memory of
+ * the previous one.
+ *
+ * @version 1.6
+ */
+class URIColumns
+{
+public:
+    /** The location of a part within its URI string. */
+    struct Range
+    {
+        uint32_t begin;
+        uint32_t size;
+    };
+
+    /** Parse the given URI strings, replacing the current content. */
+    SERVUS_API void parse(const std::string* uris, size_t count);
+
+    /** @overload */
+    SERVUS_API void parse(const std::vector<std::string>& uris);
+
+    /** @return the number of parsed URIs. */
+    size_t size() const { return results.size(); }
+
+    std::vector<Range> schemes;
+    std::vector<Range> userinfos;
+    std::vector<Range> hosts;
+    std::vector<uint16_t> ports;
+    std::vector<Range> paths;
+    std::vector<Range> queries;
+    std::vector<Range> fragments;
+    std::vector<int32_t> results; //!< URI::Result code of each URI
+};
+
+inline bool operator==(const std::string& lhs, const URI::Part& rhs)
+{
+    return rhs == lhs;
+}
+
+inline bool operator!=(const std::string& lhs, const URI::Part& rhs)
+{
+    return rhs != lhs;
+}
+
+inline std::string operator+(const std::string& lhs, const URI::Part& rhs)
+{
+    return std::string(lhs).append(rhs.data(), rhs.size());
+}
+
+inline std::string operator+(const URI::Part& lhs, const std::string& rhs)
+{
+    return lhs.str().append(rhs);
+}
+
+inline std::string operator+(const char* lhs, const URI::Part& rhs)
+{
+    return std::string(lhs).append(rhs.data(), rhs.size());
+}
+
+inline std::string operator+(const URI::Part& lhs, const char* rhs)
+{
+    return lhs.str().append(rhs);
+}
+
+inline std::ostream& operator<<(std::ostream& os, const URI::Part& part)
+{
+    return os.write(part.data(), std::streamsize(part.size()));
+}
+
+inline std::ostream& operator<<(std::ostream& os, const URI& uri)
+{
+    return os << uri.getString();
 }
 }
 
 namespace std
 {
+template <>
+struct hash<servus::URI>
+{
+    typedef size_t result_type;
+
+    result_type operator()(const servus::URI& uri) const
+    {
+        return uri.getHash();
+    }
+};
+
 inline std::string to_string(const servus::URI& uri)
 {
-    ostringstream os;
-    os << uri;
-    return os.str();
+    return uri.getString().str();
 }
 }
 #endif // SERVUS_URI_H
@@ -0,0 +1,115 @@
+/* Copyright (c) 2017, Human Brain Project
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests the incremental hashing of byte ranges and files
+
+#define BOOST_TEST_MODULE servus_hasher
+#include <boost/test/unit_test.hpp>
+
+#include <servus/hasher.h>
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace
+{
+const std::string fox = "The quick brown fox jumps over the lazy dog.";
+// Values from http://en.wikipedia.org/wiki/MD5#MD5_hashes
+const servus::uint128_t foxHash(0xE4D909C290D0FB1Cull, 0xA068FFADDF22CBD0ull);
+const servus::uint128_t emptyHash(0xD41D8CD98F00B204ull,
+                                  0xE9800998ECF8427Eull);
+}
+
+BOOST_AUTO_TEST_CASE(byte_ranges)
+{
+    BOOST_CHECK_EQUAL(servus::make_uint128(fox.data(), fox.size()), foxHash);
+    BOOST_CHECK_EQUAL(servus::make_uint128(nullptr, 0), emptyHash);
+
+    // embedded null characters are part of the hash
+    const std::string binary("a\0b", 3);
+    BOOST_CHECK_NE(servus::make_uint128(binary), servus::make_uint128("a"));
+    BOOST_CHECK_EQUAL(servus::make_uint128(binary),
+                      servus::make_uint128(binary.data(), 3));
+
+    servus::Hasher hasher;
+    BOOST_CHECK_EQUAL(hasher.finalize(), emptyHash);
+
+    // any split of the data gives the same hash, also across MD5 blocks
+    std::string data;
+    std::mt19937 random;
+    for (size_t i = 0; i < 1000; ++i)
+        data.push_back(char(random()));
+    const servus::uint128_t expected = servus::make_uint128(data);
+
+    for (size_t step = 1; step < 200; step += 7)
+    {
+        for (size_t i = 0; i < data.size(); i += step)
+            hasher.update(data.data() + i, std::min(step, data.size() - i));
+        BOOST_CHECK_EQUAL(hasher.finalize(), expected);
+    }
+
+    // finalize restarts the hasher
+    hasher.update(fox.substr(0, 10)).update(fox.substr(10));
+    BOOST_CHECK_EQUAL(hasher.finalize(), foxHash);
+    BOOST_CHECK_EQUAL(hasher.finalize(), emptyHash);
+
+    servus::Hasher moved(std::move(hasher));
+    moved.update(fox);
+    BOOST_CHECK_EQUAL(moved.finalize(), foxHash);
+}
+
+BOOST_AUTO_TEST_CASE(files)
+{
+    const std::string filename =
+        "servus_hasher_" + servus::make_UUID().getString();
+
+    std::string data;
+    std::mt19937 random;
+    for (size_t i = 0; i < 100000; ++i)
+        data.push_back(char(random()));
+    {
+        std::ofstream file(filename.c_str(), std::ios::binary);
+        file.write(data.data(), std::streamsize(data.size()));
+    }
+
+    servus::Hasher hasher;
+    BOOST_CHECK(hasher.updateFile(filename));
+    BOOST_CHECK_EQUAL(hasher.finalize(), servus::make_uint128(data));
+
+    // files add to the data hashed so far
+    hasher.update(fox);
+    BOOST_CHECK(hasher.updateFile(filename));
+    BOOST_CHECK_EQUAL(hasher.finalize(), servus::make_uint128(fox + data));
+
+    {
+        std::ofstream file(filename.c_str(), std::ios::trunc);
+    }
+    BOOST_CHECK(hasher.updateFile(filename));
+    BOOST_CHECK_EQUAL(hasher.finalize(), emptyHash);
+    ::remove(filename.c_str());
+
+    BOOST_CHECK(!hasher.updateFile(filename));
+    BOOST_CHECK_EQUAL(hasher.finalize(), emptyHash);
+
+#ifndef _WIN32
+    // devices can't be mapped and are read instead
+    BOOST_CHECK(hasher.updateFile("/dev/null"));
+    BOOST_CHECK_EQUAL(hasher.finalize(), emptyHash);
+#endif
+}
@@ -0,0 +1,151 @@
+/* Copyright (c) 2017, Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Measures the lookup speed and heap size of a snapshot compared to the nested
+// maps it is created from
+
+#define BOOST_TEST_MODULE servus_perf_snapshot
+#include <boost/test/unit_test.hpp>
+
+#include <servus/snapshot.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace
+{
+const size_t N_INSTANCES = 2000;
+const size_t N_KEYS = 10;
+
+// Live heap bytes; each allocation is prefixed with its size
+std::atomic<size_t> _allocated(0);
+const size_t HEADER = 16;
+
+servus::Servus::Data _createData(const std::string& prefix)
+{
+    servus::Servus::Data data;
+    for (size_t i = 0; i < N_INSTANCES; ++i)
+    {
+        auto& values = data["instance_" + std::to_string(i) + "._zeq._tcp"];
+        for (size_t j = 0; j < N_KEYS; ++j)
+            values["key" + std::to_string(j)] = prefix + std::to_string(i * j);
+    }
+    return data;
+}
+
+void _measure(const std::string& prefix)
+{
+    const servus::Servus::Data data = _createData(prefix);
+
+    size_t start = _allocated;
+    const servus::Servus::Data copy(data);
+    const size_t mapSize = _allocated - start;
+
+    start = _allocated;
+    const servus::Snapshot snapshot(data);
+    const size_t snapshotSize = _allocated - start;
+
+    std::cerr << N_INSTANCES * N_KEYS << " values of " << prefix.size() + 4
+              << " bytes: " << mapSize / 1024 << " KiB in maps, "
+              << snapshotSize / 1024 << " KiB in a snapshot" << std::endl;
+    BOOST_CHECK(snapshot.getData() == copy);
+    BOOST_CHECK_LT(snapshotSize, mapSize);
+}
+}
+
+void* operator new(const size_t size)
+{
+    char* block = static_cast<char*>(std::malloc(size + HEADER));
+    if (!block)
+        throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(block) = size;
+    _allocated += size;
+    return block + HEADER;
+}
+
+// GCC does not see that the inlined deletes free the blocks allocated above
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* ptr) noexcept
+{
+    if (!ptr)
+        return;
+    char* block = static_cast<char*>(ptr) - HEADER;
+    _allocated -= *reinterpret_cast<size_t*>(block);
+    std::free(block);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+BOOST_AUTO_TEST_CASE(lookup)
+{
+    const servus::Servus::Data data = _createData("");
+    const servus::Snapshot snapshot(data, 1);
+
+    std::vector<std::pair<std::string, std::string>> queries;
+    for (size_t i = 0; i < N_INSTANCES; ++i)
+        for (size_t j = 0; j < N_KEYS; ++j)
+            queries.emplace_back("instance_" + std::to_string(i) +
+                                     "._zeq._tcp",
+                                 "key" + std::to_string((i + j) % N_KEYS));
+
+    const size_t nRounds = 10;
+    size_t mapHits = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nRounds; ++i)
+        for (const auto& query : queries)
+        {
+            const auto instance = data.find(query.first);
+            if (instance != data.end() && instance->second.count(query.second))
+                ++mapHits;
+        }
+    const std::chrono::duration<double, std::micro> mapTime =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    size_t snapshotHits = 0;
+    startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nRounds; ++i)
+        for (const auto& query : queries)
+            if (snapshot.containsKey(query.first, query.second))
+                ++snapshotHits;
+    const std::chrono::duration<double, std::micro> snapshotTime =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    const size_t nQueries = nRounds * queries.size();
+    std::cerr << nQueries / mapTime.count() << " map lookups/us, "
+              << nQueries / snapshotTime.count() << " snapshot lookups/us"
+              << std::endl;
+    BOOST_CHECK_EQUAL(mapHits, nQueries);
+    BOOST_CHECK_EQUAL(snapshotHits, nQueries);
+}
+
+BOOST_AUTO_TEST_CASE(short_values)
+{
+    _measure("");
+}
+
+BOOST_AUTO_TEST_CASE(long_values)
+{
+    _measure("tcp://node.example.com:");
+}
@@ -0,0 +1,375 @@
+/* Copyright (c) 2017, Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Measures the throughput of 128 bit integer operations
+#define BOOST_TEST_MODULE servus_perf_uint128_t
+#include <boost/test/unit_test.hpp>
+
+#include <servus/uint128Map.h>
+#include <servus/uint128_t.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+const size_t N_VALUES = 1024;
+const size_t N_ROUNDS = 2000;
+
+std::vector<servus::uint128_t> _createValues()
+{
+    std::mt19937_64 random;
+    std::vector<servus::uint128_t> values;
+    values.reserve(N_VALUES);
+    for (size_t i = 0; i < N_VALUES; ++i)
+        values.push_back(servus::uint128_t(random() >> (i % 64), random() | 1));
+    return values;
+}
+
+template <typename F>
+void _measure(const std::string& name, const F& operation)
+{
+    const std::vector<servus::uint128_t> values = _createValues();
+    servus::uint128_t result;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N_ROUNDS; ++i)
+        for (size_t j = 1; j < N_VALUES; ++j)
+            result += operation(values[j - 1], values[j]);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    std::cout << name << ": "
+              << N_ROUNDS * (N_VALUES - 1) / elapsed.count() / 1e6
+              << " M ops/s (" << result << ")" << std::endl;
+}
+
+/** The carry-based addition used before the native implementation. */
+servus::uint128_t _add(const servus::uint128_t& a, const servus::uint128_t& b)
+{
+    servus::uint128_t result(a.high() + b.high(), a.low() + b.low());
+    if (result.low() < a.low())
+        ++result.high();
+    return result;
+}
+
+/** The snprintf-based formatting used before toChars(). */
+std::string _snprintf(const servus::uint128_t& value)
+{
+    char buffer[34];
+    snprintf(buffer, 34, "%llx:%llx", (unsigned long long)value.high(),
+             (unsigned long long)value.low());
+    return std::string(buffer);
+}
+
+/** The strtoull-based parsing used before fromChars(). */
+servus::uint128_t _strtoull(const std::string& string)
+{
+    char* next = nullptr;
+    servus::uint128_t value;
+    value.high() = ::strtoull(string.c_str(), &next, 16);
+    if (*next == '\0')
+        return servus::uint128_t(value.high());
+    if (::strncmp(next, "\\058", 4) == 0)
+        next += 3;
+    value.low() = ::strtoull(next + 1, nullptr, 16);
+    return value;
+}
+
+/** The hash used before servus::detail::hash(). */
+struct XorHash
+{
+    size_t operator()(const servus::uint128_t& value) const
+    {
+        return std::hash<uint64_t>()(value.high()) ^
+               std::hash<uint64_t>()(value.low());
+    }
+};
+
+/** @return the fraction of buckets of a table of the key count used. */
+template <typename H>
+double _bucketUsage(const std::vector<servus::uint128_t>& keys)
+{
+    const size_t mask = keys.size() - 1;
+    std::vector<bool> used(keys.size());
+    size_t nUsed = 0;
+    for (const auto& key : keys)
+    {
+        const size_t bucket = H()(key) & mask;
+        nUsed += !used[bucket];
+        used[bucket] = true;
+    }
+    return double(nUsed) / keys.size();
+}
+
+template <typename Map>
+void _measureMap(const std::string& name,
+                 const std::vector<servus::uint128_t>& keys)
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    Map map;
+    for (size_t i = 0; i < keys.size(); ++i)
+        map[keys[i]] = i;
+    const auto inserted = std::chrono::high_resolution_clock::now();
+
+    size_t sum = 0;
+    for (const auto& key : keys)
+        sum += map.find(key)->second;
+    const auto found = std::chrono::high_resolution_clock::now();
+
+    const std::chrono::duration<double> insert = inserted - startTime;
+    const std::chrono::duration<double> find = found - inserted;
+    std::cout << name << ": insert " << keys.size() / insert.count() / 1e6
+              << ", find " << keys.size() / find.count() / 1e6 << " M ops/s"
+              << std::endl;
+    BOOST_CHECK_EQUAL(sum, keys.size() * (keys.size() - 1) / 2);
+}
+
+/** The make_UUID() used before the thread-local engines. */
+servus::uint128_t _lockedUUID()
+{
+    static std::mt19937_64 engine(std::random_device{}());
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    servus::uint128_t value;
+    while (value.high() == 0)
+    {
+        value.high() = engine();
+        value.low() = engine();
+    }
+    return value;
+}
+
+/** Run the UUID generator on the given number of threads. */
+template <typename F>
+void _measureUUIDs(const std::string& name, const size_t nThreads,
+                   const F& generate)
+{
+    const size_t nUUIDs = 1000000;
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> results(nThreads);
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nThreads; ++i)
+        threads.push_back(std::thread([&results, &generate, i] {
+            // sum locally, adjacent results share a cache line
+            uint64_t result = 0;
+            for (size_t j = 0; j < nUUIDs; ++j)
+                result += generate().low();
+            results[i] = result;
+        }));
+    for (auto& thread : threads)
+        thread.join();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    uint64_t sum = 0;
+    for (const uint64_t result : results)
+        sum += result;
+    std::cout << name << ", " << nThreads
+              << " threads: " << nThreads * nUUIDs / elapsed.count() / 1e6
+              << " M UUIDs/s (" << sum << ")" << std::endl;
+    BOOST_CHECK_NE(sum, 0);
+}
+
+template <typename F>
+void _measureStrings(const std::string& name, const F& operation)
+{
+    const std::vector<servus::uint128_t> values = _createValues();
+    std::vector<std::string> strings;
+    for (const auto& value : values)
+        strings.push_back(value.getString());
+
+    size_t result = 0;
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N_ROUNDS; ++i)
+        for (size_t j = 0; j < N_VALUES; ++j)
+            result += operation(values[j], strings[j]);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    std::cout << name << ": " << N_ROUNDS * N_VALUES / elapsed.count() / 1e6
+              << " M ids/s (" << result << ")" << std::endl;
+}
+}
+
+BOOST_AUTO_TEST_CASE(arithmetic)
+{
+    typedef const servus::uint128_t& Arg;
+    _measure("add", [](Arg a, Arg b) { return a + b; });
+    _measure("add (carry)", [](Arg a, Arg b) { return _add(a, b); });
+    _measure("subtract", [](Arg a, Arg b) { return a - b; });
+    _measure("multiply", [](Arg a, Arg b) { return a * b; });
+    _measure("multiply (portable)",
+             [](Arg a, Arg b) { return servus::detail::multiply(a, b); });
+    _measure("divide", [](Arg a, Arg b) { return a / b; });
+    _measure("divide (portable)", [](Arg a, Arg b) {
+        servus::uint128_t remainder;
+        return servus::detail::divide(a, b, remainder);
+    });
+    _measure("shift",
+             [](Arg a, Arg b) { return a << unsigned(b.low() & 127); });
+    _measure("compare", [](Arg a, Arg b) { return servus::uint128_t(a < b); });
+}
+
+BOOST_AUTO_TEST_CASE(vector)
+{
+    const size_t nIDs = 1000000;
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<servus::uint128_t> ids;
+    ids.reserve(nIDs);
+    for (size_t i = 0; i < nIDs; ++i)
+        ids.push_back(servus::uint128_t(i, i));
+    const auto filled = std::chrono::high_resolution_clock::now();
+
+    size_t nEqual = 0;
+    for (size_t i = 0; i < 10; ++i)
+    {
+        const std::vector<servus::uint128_t> copy = ids;
+        nEqual += copy.back() == ids.back();
+    }
+    const auto copied = std::chrono::high_resolution_clock::now();
+
+    const std::chrono::duration<double> fill = filled - startTime;
+    const std::chrono::duration<double> copy = copied - filled;
+    std::cout << "fill: " << nIDs / fill.count() / 1e6 << " M ids/s, copy: "
+              << 10 * nIDs / copy.count() / 1e6 << " M ids/s, "
+              << sizeof(servus::uint128_t) << " bytes/id" << std::endl;
+    BOOST_CHECK_EQUAL(nEqual, 10);
+}
+
+BOOST_AUTO_TEST_CASE(string)
+{
+    typedef const servus::uint128_t& Value;
+    typedef const std::string& String;
+    _measureStrings("snprintf", [](Value value, String) {
+        return _snprintf(value).size();
+    });
+    _measureStrings("getString", [](Value value, String) {
+        return value.getString().size();
+    });
+    _measureStrings("toChars", [](Value value, String) {
+        char buffer[servus::uint128_t::MAX_CHARS];
+        return size_t(value.toChars(buffer, buffer + sizeof(buffer)) - buffer);
+    });
+    _measureStrings("ostream", [](Value value, String) {
+        std::ostringstream stream;
+        stream << value;
+        return stream.str().size();
+    });
+
+    _measureStrings("strtoull", [](Value, String str) {
+        return _strtoull(str).low();
+    });
+    _measureStrings("operator=", [](Value, String str) {
+        servus::uint128_t value;
+        value = str;
+        return value.low();
+    });
+    _measureStrings("fromChars", [](Value, String str) {
+        servus::uint128_t value;
+        value.fromChars(str.data(), str.data() + str.size());
+        return value.low();
+    });
+}
+
+BOOST_AUTO_TEST_CASE(hash)
+{
+    const size_t nKeys = 1 << 20;
+    std::vector<servus::uint128_t> sequential, sequentialHigh, equalHalves,
+        uuids;
+    for (uint64_t i = 0; i < nKeys; ++i)
+    {
+        sequential.push_back(servus::uint128_t(42, i));
+        sequentialHigh.push_back(servus::uint128_t(i, 42));
+        equalHalves.push_back(servus::uint128_t(i, i));
+        uuids.push_back(servus::make_UUID());
+    }
+
+    const std::pair<std::string, const std::vector<servus::uint128_t>*>
+        keySets[] = {{"sequential low", &sequential},
+                     {"sequential high", &sequentialHigh},
+                     {"equal halves", &equalHalves},
+                     {"UUIDs", &uuids}};
+    for (const auto& keys : keySets)
+        std::cout << keys.first << " bucket usage: xor "
+                  << _bucketUsage<XorHash>(*keys.second) << ", mixed "
+                  << _bucketUsage<std::hash<servus::uint128_t>>(*keys.second)
+                  << std::endl;
+
+    typedef std::unordered_map<servus::uint128_t, size_t, XorHash> XorMap;
+    typedef std::unordered_map<servus::uint128_t, size_t> StdMap;
+    typedef servus::Uint128Map<size_t> Uint128Map;
+    _measureMap<XorMap>("unordered_map, xor, UUIDs", uuids);
+    _measureMap<StdMap>("unordered_map, mixed, UUIDs", uuids);
+    _measureMap<Uint128Map>("Uint128Map, UUIDs", uuids);
+    _measureMap<XorMap>("unordered_map, xor, sequential", sequentialHigh);
+    _measureMap<StdMap>("unordered_map, mixed, sequential", sequentialHigh);
+    _measureMap<Uint128Map>("Uint128Map, sequential", sequentialHigh);
+}
+
+BOOST_AUTO_TEST_CASE(uuid)
+{
+    const size_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2)
+    {
+        _measureUUIDs("mutex", nThreads, _lockedUUID);
+        _measureUUIDs("make_UUID", nThreads, servus::make_UUID);
+        _measureUUIDs("make_UUIDv7", nThreads, servus::make_UUIDv7);
+    }
+
+    const size_t nUUIDs = 1000000;
+    std::vector<servus::uint128_t> uuids(nUUIDs);
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    servus::make_UUIDs(uuids.data(), uuids.data() + nUUIDs);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+    std::cout << "make_UUIDs, 1 thread: " << nUUIDs / elapsed.count() / 1e6
+              << " M UUIDs/s" << std::endl;
+    BOOST_CHECK(uuids.back().isUUID());
+}
+
+BOOST_AUTO_TEST_CASE(ordered_insert)
+{
+    // inserting time-ordered ids appends to the right of a search tree
+    typedef servus::uint128_t (*Generator)();
+    const std::pair<std::string, Generator> generators[] = {
+        {"make_UUID", servus::make_UUID}, {"make_UUIDv7", servus::make_UUIDv7}};
+    for (const auto& generator : generators)
+    {
+        const size_t nIDs = 1000000;
+        std::vector<servus::uint128_t> ids(nIDs);
+        for (auto& id : ids)
+            id = generator.second();
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        std::set<servus::uint128_t> tree(ids.begin(), ids.end());
+        const std::chrono::duration<double> elapsed =
+            std::chrono::high_resolution_clock::now() - startTime;
+        std::cout << "std::set insert, " << generator.first << ": "
+                  << nIDs / elapsed.count() / 1e6 << " M ids/s" << std::endl;
+        BOOST_CHECK_EQUAL(tree.size(), nIDs);
+    }
+}
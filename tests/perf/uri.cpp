@@ -0,0 +1,251 @@
+/* Copyright (c) 2017, Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Measures the URI parsing throughput of the different parsing APIs
+
+#define BOOST_TEST_MODULE servus_perf_uri
+#include <boost/test/unit_test.hpp>
+
+#include <servus/uri.h>
+
+#include <chrono>
+#include <iostream>
+#include <unordered_set>
+
+namespace
+{
+const size_t N_URIS = 10000;
+const size_t N_ROUNDS = 20;
+
+std::vector<std::string> _createURIs()
+{
+    std::vector<std::string> uris;
+    uris.reserve(N_URIS);
+    for (size_t i = 0; i < N_URIS; ++i)
+    {
+        const std::string n = std::to_string(i);
+        switch (i % 4)
+        {
+        case 0:
+            uris.push_back("tcp://zeroeq@node" + n + ".cluster.example.com:" +
+                           std::to_string(1024 + i) + "/events/" + n +
+                           "?session=" + n + "&schema=foo&compressor=lz4");
+            break;
+        case 1:
+            uris.push_back("http://www.example.com/api/v1/resources/" + n +
+                           "/children?offset=" + n + "&limit=100#results");
+            break;
+        case 2:
+            uris.push_back("file:///var/log/servus/instance_" + n + ".log");
+            break;
+        default:
+            uris.push_back("http://host" + n + ":invalid_port/");
+        }
+    }
+    return uris;
+}
+
+template <typename F>
+void _measure(const std::string& name, const F& parse)
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    size_t nValid = 0;
+    for (size_t i = 0; i < N_ROUNDS; ++i)
+        nValid += parse();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    std::cout << name << ": " << N_URIS * N_ROUNDS / elapsed.count() / 1e6
+              << " M URIs/s" << std::endl;
+    BOOST_CHECK_EQUAL(nValid, N_ROUNDS * N_URIS * 3 / 4);
+}
+}
+
+BOOST_AUTO_TEST_CASE(parse)
+{
+    const std::vector<std::string> uris = _createURIs();
+
+    _measure("URI", [&uris] {
+        size_t nValid = 0;
+        for (const auto& uri : uris)
+        {
+            try
+            {
+                servus::URI parsed(uri);
+                ++nValid;
+            }
+            catch (const std::exception&)
+            {
+            }
+        }
+        return nValid;
+    });
+
+    _measure("URI::tryParse", [&uris] {
+        size_t nValid = 0;
+        servus::URI parsed;
+        for (const auto& uri : uris)
+            nValid += bool(servus::URI::tryParse(uri, parsed));
+        return nValid;
+    });
+
+    _measure("URIView", [&uris] {
+        size_t nValid = 0;
+        for (const auto& uri : uris)
+            nValid += servus::URIView(uri).isValid();
+        return nValid;
+    });
+
+    servus::URIColumns columns;
+    _measure("URIColumns", [&uris, &columns] {
+        columns.parse(uris);
+        size_t nValid = 0;
+        for (const int32_t result : columns.results)
+            nValid += result == servus::URI::Result::SUCCESS;
+        return nValid;
+    });
+
+    BOOST_REQUIRE_EQUAL(columns.size(), uris.size());
+    const servus::URIColumns::Range& host = columns.hosts[0];
+    BOOST_CHECK_EQUAL(uris[0].substr(host.begin, host.size),
+                      "node0.cluster.example.com");
+    BOOST_CHECK_EQUAL(columns.ports[0], 1024);
+    BOOST_CHECK(columns.results[3] == servus::URI::Result::INVALID_PORT);
+}
+
+BOOST_AUTO_TEST_CASE(copy)
+{
+    std::vector<servus::URI> uris;
+    servus::URI parsed;
+    for (const auto& uri : _createURIs())
+        if (servus::URI::tryParse(uri, parsed))
+            uris.push_back(parsed);
+
+    std::vector<servus::URI> copies;
+    copies.reserve(uris.size());
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N_ROUNDS; ++i)
+    {
+        copies.clear();
+        copies.insert(copies.end(), uris.begin(), uris.end());
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    std::cout << "URI copy: " << uris.size() * N_ROUNDS / elapsed.count() / 1e6
+              << " M URIs/s" << std::endl;
+    BOOST_CHECK(copies == uris);
+}
+
+BOOST_AUTO_TEST_CASE(hash)
+{
+    std::unordered_set<servus::URI> set;
+    std::vector<servus::URI> uris;
+    servus::URI parsed;
+    for (const auto& uri : _createURIs())
+    {
+        if (!servus::URI::tryParse(uri, parsed))
+            continue;
+        uris.push_back(parsed);
+        set.insert(parsed);
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    size_t nFound = 0;
+    for (size_t i = 0; i < N_ROUNDS; ++i)
+        for (const auto& uri : uris)
+            nFound += set.count(uri);
+    std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+    std::cout << "URI lookup: " << nFound / elapsed.count() / 1e6
+              << " M URIs/s" << std::endl;
+    BOOST_CHECK_EQUAL(nFound, N_ROUNDS * uris.size());
+
+    startTime = std::chrono::high_resolution_clock::now();
+    size_t size = 0;
+    for (size_t i = 0; i < N_ROUNDS; ++i)
+        for (const auto& uri : uris)
+            size += std::to_string(uri).size();
+    elapsed = std::chrono::high_resolution_clock::now() - startTime;
+    std::cout << "URI to_string: " << N_ROUNDS * uris.size() /
+                                          elapsed.count() / 1e6
+              << " M URIs/s" << std::endl;
+    BOOST_CHECK_GT(size, 0);
+}
+
+BOOST_AUTO_TEST_CASE(percent_encoding)
+{
+    std::vector<std::string> paths;
+    size_t size = 0;
+    for (size_t i = 0; i < N_URIS; ++i)
+    {
+        paths.push_back("/data/sets/" + std::to_string(i) +
+                        "/volume rendering/brain slice #" +
+                        std::to_string(i % 100) + "/100% resolution.raw");
+        size += paths.back().size();
+    }
+
+    std::vector<std::string> encoded;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N_ROUNDS; ++i)
+    {
+        encoded.clear();
+        for (const auto& path : paths)
+            encoded.push_back(
+                servus::URI::encode(path, servus::URI::COMPONENT_PATH));
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+    std::cout << "URI::encode: " << size * N_ROUNDS / elapsed.count() / 1e6
+              << " MB/s" << std::endl;
+
+    size_t nDecoded = 0;
+    startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N_ROUNDS; ++i)
+        for (size_t j = 0; j < encoded.size(); ++j)
+            nDecoded += servus::URI::decode(encoded[j]) == paths[j];
+    elapsed = std::chrono::high_resolution_clock::now() - startTime;
+    std::cout << "URI::decode: " << size * N_ROUNDS / elapsed.count() / 1e6
+              << " MB/s" << std::endl;
+    BOOST_CHECK_EQUAL(nDecoded, N_ROUNDS * paths.size());
+}
+
+BOOST_AUTO_TEST_CASE(find_query)
+{
+    const size_t nKeys = 64;
+    servus::URI uri("http://www.example.com/api");
+    for (size_t i = 0; i < nKeys; ++i)
+        uri.addQuery("key" + std::to_string(i), std::to_string(i));
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < nKeys; ++i)
+        keys.push_back("key" + std::to_string(i));
+
+    const size_t nRounds = N_ROUNDS * 1000;
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    size_t nFound = 0;
+    for (size_t i = 0; i < nRounds; ++i)
+        for (const auto& key : keys)
+            nFound += uri.findQuery(key) != uri.queryEnd();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    std::cout << "URI::findQuery, " << nKeys << " keys: "
+              << nFound / elapsed.count() / 1e6 << " M lookups/s" << std::endl;
+    BOOST_CHECK_EQUAL(nFound, nRounds * nKeys);
+}
@@ -19,10 +19,15 @@
 #define BOOST_TEST_MODULE servus_servus
 #include <boost/test/unit_test.hpp>
 
+#include <servus/listener.h>
 #include <servus/servus.h>
+#include <servus/snapshot.h>
 #include <servus/uint128_t.h>
 
+#include <atomic>
+#include <chrono>
 #include <random>
+#include <thread>
 
 #ifdef SERVUS_USE_DNSSD
 #include <dns_sd.h>
@@ -48,13 +53,15 @@ uint16_t getRandomPort()
     return generator(engine);
 }
 
-void test(const std::string& serviceName)
+void test(const std::string& serviceName,
+          const servus::Servus::EventLoop eventLoop =
+              servus::Servus::EVENT_LOOP_CALLER)
 {
     const uint32_t port = getRandomPort();
 
     try
     {
-        servus::Servus service(serviceName);
+        servus::Servus service(serviceName, eventLoop);
     }
     catch (const std::runtime_error& e)
     {
@@ -68,7 +75,9 @@ void test(const std::string& serviceName)
         throw;
     }
 
-    servus::Servus service(serviceName);
+    servus::Servus service(serviceName, eventLoop);
+    BOOST_CHECK(service.getEventLoop() == eventLoop ||
+                service.getEventLoop() == servus::Servus::EVENT_LOOP_CALLER);
     const servus::Servus::Result& result =
         service.announce(port, std::to_string(port));
 
@@ -160,7 +169,7 @@ void test(const std::string& serviceName)
     BOOST_CHECK_EQUAL(service.getKeys().size(), 2);
 
     { // test updates during browsing
-        servus::Servus service2(serviceName);
+        servus::Servus service2(serviceName, eventLoop);
         BOOST_CHECK(service2.announce(port + 1, std::to_string(port + 1)));
 
         nLoops = _propagationTries;
@@ -206,7 +215,464 @@ BOOST_AUTO_TEST_CASE(test_servus)
     test(serviceName);
 }
 
+BOOST_AUTO_TEST_CASE(test_servus_event_thread)
+{
+    std::string serviceName =
+        "_servustest_" + std::to_string(servus::make_UUID()) + "._tcp";
+    test(serviceName, servus::Servus::EVENT_LOOP_THREAD);
+}
+
 BOOST_AUTO_TEST_CASE(test_driver)
 {
     test(servus::TEST_DRIVER);
 }
+
+BOOST_AUTO_TEST_CASE(concurrent_browse)
+{
+    // independent instances must browse in parallel, not one after another
+    const size_t nServices = 8;
+    const int32_t browseTime = 200;
+
+    std::vector<std::unique_ptr<servus::Servus>> services;
+    for (size_t i = 0; i < nServices; ++i)
+    {
+        services.emplace_back(new servus::Servus(
+            "_servustest_" + std::to_string(servus::make_UUID()) + "._tcp"));
+        if (!services.back()->beginBrowsing(servus::Servus::IF_LOCAL))
+        {
+            std::cerr << "Bailing, browsing not supported" << std::endl;
+            return;
+        }
+    }
+
+    std::vector<servus::Servus::Result> results(
+        nServices, servus::Servus::Result(servus::Servus::Result::PENDING));
+    std::vector<std::thread> threads;
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nServices; ++i)
+        threads.emplace_back(
+            [&, i] { results[i] = services[i]->browse(browseTime); });
+    for (auto& thread : threads)
+        thread.join();
+
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+    std::cerr << nServices << " concurrent browse(" << browseTime
+              << ") took " << elapsed.count() << " ms" << std::endl;
+
+    for (const auto& result : results)
+        BOOST_CHECK(result);
+    BOOST_CHECK_LT(elapsed.count(), 2 * browseTime);
+}
+
+BOOST_AUTO_TEST_CASE(shared_connection)
+{
+    std::vector<std::unique_ptr<servus::Servus>> services;
+    for (size_t i = 0; i < 4; ++i)
+        services.emplace_back(new servus::Servus(
+            "_servustest_" + std::to_string(servus::make_UUID()) + "._tcp",
+            i % 2 ? servus::Servus::EVENT_LOOP_THREAD
+                  : servus::Servus::EVENT_LOOP_CALLER));
+
+    BOOST_CHECK_LE(servus::Servus::getNumConnections(), 1);
+    services.clear();
+    BOOST_CHECK_EQUAL(servus::Servus::getNumConnections(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_updates)
+{
+    const std::string instance = std::to_string(servus::make_UUID());
+    servus::Servus service(servus::TEST_DRIVER);
+    servus::Servus browser(servus::TEST_DRIVER);
+    BOOST_REQUIRE(service.announce(getRandomPort(), instance));
+    BOOST_REQUIRE(browser.beginBrowsing(servus::Servus::IF_ALL));
+
+    service.set({{"foo", "bar"}, {"bar", "foo"}});
+    BOOST_CHECK(browser.browse(0));
+    BOOST_CHECK_EQUAL(browser.get(instance, "foo"), "bar");
+    BOOST_CHECK_EQUAL(browser.get(instance, "bar"), "foo");
+
+    service.setUpdateInterval(200);
+    service.set("foo", "baz"); // first update in interval is published
+    service.set("bar", "baz"); // coalesced into deferred update
+    service.set("baz", "foo");
+    BOOST_CHECK(browser.browse(0));
+    BOOST_CHECK_EQUAL(browser.get(instance, "foo"), "baz");
+    BOOST_CHECK_EQUAL(browser.get(instance, "bar"), "foo");
+    BOOST_CHECK(!browser.containsKey(instance, "baz"));
+
+    // the deferred update is published without another set()
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    BOOST_CHECK(browser.browse(0));
+    BOOST_CHECK_EQUAL(browser.get(instance, "foo"), "baz");
+    BOOST_CHECK_EQUAL(browser.get(instance, "bar"), "baz");
+    BOOST_CHECK_EQUAL(browser.get(instance, "baz"), "foo");
+}
+
+namespace
+{
+class UpdateListener : public servus::Listener
+{
+public:
+    void instanceAdded(const std::string&) final { ++added; }
+    void instanceRemoved(const std::string&) final { ++removed; }
+    void instanceUpdated(const std::string& instance,
+                         const Changes& changes_) final
+    {
+        updated = instance;
+        changes = changes_;
+    }
+
+    size_t added{0};
+    size_t removed{0};
+    std::string updated;
+    Changes changes;
+};
+}
+
+BOOST_AUTO_TEST_CASE(instance_updated)
+{
+    const std::string instance = std::to_string(servus::make_UUID());
+    servus::Servus service(servus::TEST_DRIVER);
+    servus::Servus browser(servus::TEST_DRIVER);
+    UpdateListener listener;
+    browser.addListener(&listener);
+
+    service.set({{"foo", "bar"}, {"bar", "foo"}});
+    BOOST_REQUIRE(service.announce(getRandomPort(), instance));
+    BOOST_REQUIRE(browser.beginBrowsing(servus::Servus::IF_ALL));
+    BOOST_CHECK(browser.browse(0));
+    BOOST_CHECK_EQUAL(listener.added, 1);
+    BOOST_CHECK(listener.updated.empty());
+
+    BOOST_CHECK(browser.browse(0)); // unchanged data is not reported
+    BOOST_CHECK_EQUAL(listener.added, 1);
+    BOOST_CHECK(listener.updated.empty());
+
+    service.set({{"foo", "baz"}, {"baz", "foo"}});
+    BOOST_CHECK(browser.browse(0));
+    BOOST_CHECK_EQUAL(listener.added, 1);
+    BOOST_CHECK_EQUAL(listener.updated, instance);
+    BOOST_REQUIRE_EQUAL(listener.changes.size(), 2);
+    BOOST_CHECK_EQUAL(listener.changes[0].key, "baz");
+    BOOST_CHECK(listener.changes[0].oldValue.empty());
+    BOOST_CHECK_EQUAL(listener.changes[0].newValue, "foo");
+    BOOST_CHECK_EQUAL(listener.changes[1].key, "foo");
+    BOOST_CHECK_EQUAL(listener.changes[1].oldValue, "bar");
+    BOOST_CHECK_EQUAL(listener.changes[1].newValue, "baz");
+
+    service.withdraw();
+    BOOST_CHECK(browser.browse(0));
+    BOOST_CHECK_EQUAL(listener.removed, 1);
+    browser.removeListener(&listener);
+}
+
+BOOST_AUTO_TEST_CASE(withdraw_between_browsing)
+{
+    const std::string instance = std::to_string(servus::make_UUID());
+    servus::Servus service(servus::TEST_DRIVER);
+    servus::Servus browser(servus::TEST_DRIVER);
+    UpdateListener listener;
+    browser.addListener(&listener);
+
+    BOOST_REQUIRE(service.announce(getRandomPort(), instance));
+    servus::Strings instances = browser.discover(servus::Servus::IF_ALL, 0);
+    BOOST_REQUIRE_EQUAL(instances.size(), 1);
+    BOOST_CHECK_EQUAL(instances.front(), instance);
+    BOOST_CHECK_EQUAL(listener.added, 1);
+
+    service.withdraw();
+    instances = browser.discover(servus::Servus::IF_ALL, 0);
+    BOOST_CHECK(instances.empty());
+    BOOST_CHECK(browser.getInstances().empty());
+    BOOST_CHECK_EQUAL(listener.removed, 1);
+    browser.removeListener(&listener);
+}
+
+namespace
+{
+// Calls back into the service from its event thread
+class ReentrantListener : public servus::Listener
+{
+public:
+    explicit ReentrantListener(servus::Servus& service)
+        : _service(service)
+    {
+    }
+
+    void instanceAdded(const std::string& instance) final
+    {
+        _service.set("added", instance);
+        announced = _service.isAnnounced();
+        ++added;
+    }
+    void instanceRemoved(const std::string&) final {}
+    std::atomic<size_t> added{0};
+    std::atomic<bool> announced{false};
+
+private:
+    servus::Servus& _service;
+};
+}
+
+BOOST_AUTO_TEST_CASE(reentrant_listener)
+{
+    const std::string instance = std::to_string(servus::make_UUID());
+    std::unique_ptr<servus::Servus> service;
+    try
+    {
+        service.reset(new servus::Servus("_servustest_" +
+                                             std::to_string(
+                                                 servus::make_UUID()) +
+                                             "._tcp",
+                                         servus::Servus::EVENT_LOOP_THREAD));
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cerr << "Bailing, " << e.what() << std::endl;
+        return;
+    }
+
+    ReentrantListener listener(*service);
+    service->addListener(&listener);
+    if (!service->announce(getRandomPort(), instance) ||
+        !service->beginBrowsing(servus::Servus::IF_LOCAL))
+    {
+        std::cerr << "Bailing, announce or browsing not supported"
+                  << std::endl;
+        return;
+    }
+
+    for (int i = 0; i < _propagationTries && listener.added == 0; ++i)
+        service->browse(_propagationTime);
+    service->endBrowsing();
+    service->removeListener(&listener);
+
+    if (listener.added == 0)
+    {
+        std::cerr << "Bailing, got no hosts: looks like a broken zeroconf setup"
+                  << std::endl;
+        return;
+    }
+    BOOST_CHECK(listener.announced);
+    BOOST_CHECK_EQUAL(service->get("added"), instance);
+}
+
+namespace
+{
+class SlowListener : public servus::Listener
+{
+public:
+    void instanceAdded(const std::string&) final
+    {
+        ++added;
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    void instanceRemoved(const std::string&) final {}
+    std::atomic<size_t> added{0};
+};
+
+class CountingListener : public servus::Listener
+{
+public:
+    void instanceAdded(const std::string&) final { ++added; }
+    void instanceRemoved(const std::string&) final {}
+    void instanceUpdated(const std::string&, const Changes&) final
+    {
+        ++updated;
+    }
+    std::atomic<size_t> added{0};
+    std::atomic<size_t> updated{0};
+};
+}
+
+BOOST_AUTO_TEST_CASE(slow_listener)
+{
+    // a listener of one instance must not block the other instances
+    const std::string name =
+        "_servustest_" + std::to_string(servus::make_UUID()) + "._tcp";
+    std::unique_ptr<servus::Servus> service;
+    try
+    {
+        service.reset(
+            new servus::Servus(name, servus::Servus::EVENT_LOOP_THREAD));
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cerr << "Bailing, " << e.what() << std::endl;
+        return;
+    }
+
+    servus::Servus other(name);
+    SlowListener listener;
+    service->addListener(&listener);
+    if (!other.announce(getRandomPort(), std::to_string(servus::make_UUID())) ||
+        !service->beginBrowsing(servus::Servus::IF_LOCAL))
+    {
+        std::cerr << "Bailing, announce or browsing not supported"
+                  << std::endl;
+        return;
+    }
+
+    for (int i = 0; i < _propagationTries && listener.added == 0; ++i)
+        service->browse(_propagationTime);
+    if (listener.added == 0)
+    {
+        service->endBrowsing();
+        service->removeListener(&listener);
+        std::cerr << "Bailing, got no hosts: looks like a broken zeroconf setup"
+                  << std::endl;
+        return;
+    }
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    BOOST_CHECK(other.isAnnounced());
+    other.withdraw();
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+    BOOST_CHECK_LT(elapsed.count(), 250);
+
+    service->endBrowsing();
+    service->removeListener(&listener);
+}
+
+BOOST_AUTO_TEST_CASE(listeners_while_browsing)
+{
+    // listeners are changed while the event thread invokes them
+    const std::string name =
+        "_servustest_" + std::to_string(servus::make_UUID()) + "._tcp";
+    std::unique_ptr<servus::Servus> service;
+    try
+    {
+        service.reset(
+            new servus::Servus(name, servus::Servus::EVENT_LOOP_THREAD));
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cerr << "Bailing, " << e.what() << std::endl;
+        return;
+    }
+
+    servus::Servus other(name);
+    CountingListener listener;
+    service->addListener(&listener);
+    if (!other.announce(getRandomPort(), std::to_string(servus::make_UUID())) ||
+        !service->beginBrowsing(servus::Servus::IF_LOCAL))
+    {
+        std::cerr << "Bailing, announce or browsing not supported"
+                  << std::endl;
+        return;
+    }
+
+    std::atomic<bool> running{true};
+    std::thread changer([&] {
+        std::vector<CountingListener> listeners(16);
+        while (running)
+        {
+            for (auto& i : listeners)
+                service->addListener(&i);
+            for (auto& i : listeners)
+                service->removeListener(&i);
+        }
+    });
+
+    for (int i = 0; i < _propagationTries && listener.updated < 5; ++i)
+    {
+        other.set("value", std::to_string(i));
+        service->browse(_propagationTime / 10);
+    }
+    running = false;
+    changer.join();
+    service->endBrowsing();
+    service->removeListener(&listener);
+
+    if (listener.added == 0)
+        std::cerr << "Bailing, got no hosts: looks like a broken zeroconf setup"
+                  << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot)
+{
+    const std::string instance = std::to_string(servus::make_UUID());
+    servus::Servus service(servus::TEST_DRIVER);
+    servus::Servus browser(servus::TEST_DRIVER);
+
+    const servus::Servus::SnapshotPtr empty = browser.getSnapshot();
+    BOOST_REQUIRE(empty);
+    BOOST_CHECK_EQUAL(empty->getVersion(), 0);
+    BOOST_CHECK_EQUAL(browser.getVersion(), 0);
+
+    service.set("foo", "bar");
+    BOOST_REQUIRE(service.announce(getRandomPort(), instance));
+    BOOST_REQUIRE(browser.beginBrowsing(servus::Servus::IF_ALL));
+    BOOST_CHECK(browser.browse(0));
+
+    const servus::Servus::SnapshotPtr first = browser.getSnapshot();
+    BOOST_CHECK_GT(first->getVersion(), 0);
+    BOOST_CHECK_EQUAL(browser.getVersion(), first->getVersion());
+    BOOST_REQUIRE(first->containsKey(instance, "foo"));
+    BOOST_CHECK_EQUAL(first->get(instance, "foo"), "bar");
+    BOOST_CHECK(empty->getInstances().empty());
+
+    // unchanged data does not publish a new snapshot
+    BOOST_CHECK(browser.browse(0));
+    BOOST_CHECK_EQUAL(browser.getSnapshot(), first);
+
+    service.set("foo", "baz");
+    BOOST_CHECK(browser.browse(0));
+    const servus::Servus::SnapshotPtr second = browser.getSnapshot();
+    BOOST_CHECK_GT(second->getVersion(), first->getVersion());
+    BOOST_CHECK_EQUAL(second->get(instance, "foo"), "baz");
+    BOOST_CHECK_EQUAL(first->get(instance, "foo"), "bar");
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_reads)
+{
+    // one thread browses, the others read discovered data concurrently
+    const std::string instance = std::to_string(servus::make_UUID());
+    servus::Servus service(servus::TEST_DRIVER);
+    servus::Servus browser(servus::TEST_DRIVER);
+    service.set("value", "0");
+    BOOST_REQUIRE(service.announce(getRandomPort(), instance));
+    BOOST_REQUIRE(browser.beginBrowsing(servus::Servus::IF_ALL));
+
+    std::atomic<bool> running(true);
+    std::thread browsing([&] {
+        for (size_t i = 1; i <= 1000; ++i)
+        {
+            service.set("value", std::to_string(i));
+            browser.browse(0);
+        }
+        running = false;
+    });
+
+    // Boost.Test is not thread-safe, count errors instead
+    std::vector<std::thread> readers;
+    std::atomic<size_t> nReads(0);
+    std::atomic<size_t> nErrors(0);
+    for (size_t i = 0; i < 4; ++i)
+        readers.emplace_back([&] {
+            do
+            {
+                for (const auto& name : browser.getInstances())
+                    for (const auto& key : browser.getKeys(name))
+                        if (!browser.containsKey(name, key))
+                            ++nErrors;
+
+                const std::string value = browser.get(instance, "value");
+                const servus::Servus::SnapshotPtr snapshot =
+                    browser.getSnapshot();
+                if (snapshot->getVersion() > browser.getVersion())
+                    ++nErrors;
+                ++nReads;
+            } while (running);
+        });
+
+    browsing.join();
+    for (auto& reader : readers)
+        reader.join();
+
+    BOOST_CHECK_GE(nReads, readers.size());
+    BOOST_CHECK_EQUAL(nErrors, 0);
+    BOOST_CHECK_EQUAL(browser.get(instance, "value"), "1000");
+}
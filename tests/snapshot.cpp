@@ -0,0 +1,117 @@
+/* Copyright (c) 2017, Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#define BOOST_TEST_MODULE servus_snapshot
+#include <boost/test/unit_test.hpp>
+
+#include <servus/snapshot.h>
+
+
+namespace
+{
+const size_t N_INSTANCES = 2000;
+const size_t N_KEYS = 10;
+
+servus::Servus::Data _createData()
+{
+    servus::Servus::Data data;
+    for (size_t i = 0; i < N_INSTANCES; ++i)
+    {
+        auto& values = data["instance_" + std::to_string(i) + "._zeq._tcp"];
+        for (size_t j = 0; j < N_KEYS; ++j)
+            values["key" + std::to_string(j)] = std::to_string(i * j);
+    }
+    return data;
+}
+}
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+    const servus::Snapshot snapshot;
+    BOOST_CHECK_EQUAL(snapshot.getVersion(), 0);
+    BOOST_CHECK(snapshot.getInstances().empty());
+    BOOST_CHECK(snapshot.getKeys("foo").empty());
+    BOOST_CHECK(!snapshot.containsKey("foo", "bar"));
+    BOOST_CHECK(snapshot.get("foo", "bar").empty());
+    BOOST_CHECK(snapshot.getData().empty());
+}
+
+BOOST_AUTO_TEST_CASE(lookup)
+{
+    servus::Servus::Data data;
+    data["foo"]["bar"] = "1";
+    data["foo"]["baz"] = "2";
+    data["bar"]["baz"] = "3";
+    data["bar"]["foo"] = "";
+    data["baz"];
+
+    const servus::Snapshot snapshot(data, 42);
+    BOOST_CHECK_EQUAL(snapshot.getVersion(), 42);
+    BOOST_CHECK(snapshot.getData() == data);
+
+    const servus::Strings& instances = snapshot.getInstances();
+    BOOST_REQUIRE_EQUAL(instances.size(), 3);
+    BOOST_CHECK_EQUAL(instances[0], "bar");
+    BOOST_CHECK_EQUAL(instances[1], "baz");
+    BOOST_CHECK_EQUAL(instances[2], "foo");
+
+    const servus::Strings keys = snapshot.getKeys("bar");
+    BOOST_REQUIRE_EQUAL(keys.size(), 2);
+    BOOST_CHECK_EQUAL(keys[0], "baz");
+    BOOST_CHECK_EQUAL(keys[1], "foo");
+    BOOST_CHECK(snapshot.getKeys("baz").empty());
+
+    BOOST_CHECK_EQUAL(snapshot.get("foo", "bar"), "1");
+    BOOST_CHECK_EQUAL(snapshot.get("foo", "baz"), "2");
+    BOOST_CHECK_EQUAL(snapshot.get("bar", "baz"), "3");
+    BOOST_CHECK(snapshot.containsKey("bar", "foo"));
+    BOOST_CHECK(!snapshot.containsKey("foo", "foo"));
+    BOOST_CHECK(!snapshot.containsKey("baz", "foo"));
+    BOOST_CHECK(!snapshot.containsKey("foobar", "foo"));
+    BOOST_CHECK(snapshot.get("foo", "foo").empty());
+
+    // reads return views into the snapshot instead of copies
+    BOOST_CHECK_EQUAL(&snapshot.getInstances(), &instances);
+    BOOST_CHECK(snapshot.get("foo", "bar").data() ==
+                snapshot.get("foo", "bar").data());
+}
+
+BOOST_AUTO_TEST_CASE(many_instances)
+{
+    const servus::Servus::Data data = _createData();
+    const servus::Snapshot snapshot(data, 1);
+    BOOST_CHECK_EQUAL(snapshot.getInstances().size(), N_INSTANCES);
+
+    size_t hits = 0;
+    for (size_t i = 0; i < N_INSTANCES; ++i)
+    {
+        const std::string instance =
+            "instance_" + std::to_string(i) + "._zeq._tcp";
+        for (size_t j = 0; j < N_KEYS; ++j)
+        {
+            const std::string key = "key" + std::to_string(j);
+            if (snapshot.containsKey(instance, key) &&
+                snapshot.get(instance, key) == std::to_string(i * j))
+            {
+                ++hits;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(hits, N_INSTANCES * N_KEYS);
+    BOOST_CHECK(snapshot.getData() == data);
+}
@@ -0,0 +1,187 @@
+/* Copyright (c) 2017, Human Brain Project
+ *
+ * This file is part of Servus <https://github.com/HBPVIS/Servus>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests the hash function and the hash containers for 128 bit integers
+
+#define BOOST_TEST_MODULE servus_uint128Map
+#include <boost/test/unit_test.hpp>
+
+#include <servus/uint128Map.h>
+
+#include <map>
+#include <random>
+#include <unordered_set>
+
+BOOST_AUTO_TEST_CASE(hash)
+{
+    // structured keys which collided with the former xor of the halves
+    const size_t nKeys = 1 << 16;
+    const size_t mask = nKeys - 1;
+    std::unordered_set<size_t> hashes;
+    std::vector<bool> buckets(nKeys);
+    size_t nBuckets = 0;
+    for (size_t i = 0; i < nKeys; ++i)
+    {
+        const size_t value =
+            std::hash<servus::uint128_t>()(servus::uint128_t(i, i));
+        hashes.insert(value);
+        if (!buckets[value & mask])
+        {
+            buckets[value & mask] = true;
+            ++nBuckets;
+        }
+    }
+    BOOST_CHECK_EQUAL(hashes.size(), nKeys);
+    // random placement fills 1 - 1/e of the buckets
+    BOOST_CHECK_GT(nBuckets, nKeys / 2);
+
+    // halves which cancelled the constants of a single multiplication
+    hashes.clear();
+    for (size_t i = 0; i < nKeys; ++i)
+    {
+        hashes.insert(std::hash<servus::uint128_t>()(
+            servus::uint128_t(0xa0761d6478bd642full, i)));
+        hashes.insert(std::hash<servus::uint128_t>()(
+            servus::uint128_t(i, 0xe7037ed1a0b428dbull)));
+    }
+    BOOST_CHECK_EQUAL(hashes.size(), 2 * nKeys);
+
+    const servus::uint128_t id(1, 2);
+    BOOST_CHECK_EQUAL(std::hash<servus::uint128_t>()(id),
+                      std::hash<servus::uint128_t>()(servus::uint128_t(1, 2)));
+    BOOST_CHECK_NE(std::hash<servus::uint128_t>()(id),
+                   std::hash<servus::uint128_t>()(servus::uint128_t(2, 1)));
+}
+
+BOOST_AUTO_TEST_CASE(map)
+{
+    servus::Uint128Map<int> ids;
+    BOOST_CHECK(ids.empty());
+    BOOST_CHECK(ids.begin() == ids.end());
+    BOOST_CHECK(ids.find(servus::uint128_t()) == ids.end());
+    BOOST_CHECK_EQUAL(ids.erase(servus::uint128_t()), 0);
+
+    ids[servus::uint128_t()] = 42;
+    BOOST_CHECK_EQUAL(ids.size(), 1);
+    BOOST_CHECK_EQUAL(ids[servus::uint128_t()], 42);
+    BOOST_CHECK_EQUAL(ids.count(servus::uint128_t()), 1);
+
+    const auto inserted = ids.insert(std::make_pair(servus::uint128_t(1), 1));
+    BOOST_CHECK(inserted.second);
+    BOOST_CHECK_EQUAL(inserted.first->second, 1);
+    const auto existing = ids.insert(std::make_pair(servus::uint128_t(1), 2));
+    BOOST_CHECK(!existing.second);
+    BOOST_CHECK(existing.first == inserted.first);
+    BOOST_CHECK_EQUAL(existing.first->second, 1);
+
+    const servus::Uint128Map<int>& constMap = ids;
+    servus::Uint128Map<int>::const_iterator i =
+        constMap.find(servus::uint128_t(1));
+    BOOST_REQUIRE(i != constMap.end());
+    BOOST_CHECK_EQUAL(i->second, 1);
+    i = ids.begin(); // conversion from iterator
+
+    BOOST_CHECK_EQUAL(ids.erase(servus::uint128_t()), 1);
+    BOOST_CHECK_EQUAL(ids.erase(servus::uint128_t()), 0);
+    BOOST_CHECK_EQUAL(ids.size(), 1);
+
+    ids.clear();
+    BOOST_CHECK(ids.empty());
+    BOOST_CHECK(ids.begin() == ids.end());
+    BOOST_CHECK_GT(ids.bucket_count(), 0);
+
+    // grows at a load factor of 3/4, but not for existing keys
+    for (size_t j = 0; j < 12; ++j)
+        ids[servus::uint128_t(j)] = int(j);
+    BOOST_CHECK_EQUAL(ids.bucket_count(), 16);
+    BOOST_CHECK(!ids.insert(std::make_pair(servus::uint128_t(0), 0)).second);
+    BOOST_CHECK_EQUAL(ids.bucket_count(), 16);
+    ids[servus::uint128_t(12)] = 12;
+    BOOST_CHECK_EQUAL(ids.bucket_count(), 32);
+
+    servus::Uint128Map<int> reserved;
+    reserved.reserve(12);
+    BOOST_CHECK_EQUAL(reserved.bucket_count(), 16);
+    reserved.reserve(13);
+    BOOST_CHECK_EQUAL(reserved.bucket_count(), 32);
+}
+
+BOOST_AUTO_TEST_CASE(map_against_std_map)
+{
+    // random operations on few keys to exercise probing and backward shifts
+    std::mt19937_64 random;
+    servus::Uint128Map<uint64_t> map;
+    std::map<servus::uint128_t, uint64_t> reference;
+
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        const servus::uint128_t key(random() % 4, random() % 512);
+        switch (random() % 3)
+        {
+        case 0:
+            map[key] = i;
+            reference[key] = i;
+            break;
+        case 1:
+            BOOST_CHECK_EQUAL(map.erase(key), reference.erase(key));
+            break;
+        default:
+        {
+            const auto found = map.find(key);
+            const auto expected = reference.find(key);
+            BOOST_REQUIRE_EQUAL(found == map.end(),
+                                expected == reference.end());
+            if (found != map.end())
+                BOOST_CHECK_EQUAL(found->second, expected->second);
+        }
+        }
+        BOOST_REQUIRE_EQUAL(map.size(), reference.size());
+    }
+
+    size_t nEntries = 0;
+    for (const auto& entry : map)
+    {
+        BOOST_CHECK_EQUAL(reference[entry.first], entry.second);
+        ++nEntries;
+    }
+    BOOST_CHECK_EQUAL(nEntries, reference.size());
+}
+
+BOOST_AUTO_TEST_CASE(set)
+{
+    servus::Uint128Set ids;
+    ids.reserve(1000);
+    const size_t nBuckets = ids.bucket_count();
+    BOOST_CHECK_GE(nBuckets * 3 / 4, 1000);
+
+    for (uint64_t i = 0; i < 1000; ++i)
+        BOOST_CHECK(ids.insert(servus::uint128_t(i, i)).second);
+    BOOST_CHECK_EQUAL(ids.bucket_count(), nBuckets);
+    BOOST_CHECK_EQUAL(ids.size(), 1000);
+    BOOST_CHECK(!ids.insert(servus::uint128_t(5, 5)).second);
+
+    for (uint64_t i = 0; i < 1000; i += 2)
+        BOOST_CHECK_EQUAL(ids.erase(servus::uint128_t(i, i)), 1);
+    for (uint64_t i = 0; i < 1000; ++i)
+        BOOST_CHECK_EQUAL(ids.count(servus::uint128_t(i, i)), i % 2);
+
+    uint64_t sum = 0;
+    for (const servus::uint128_t& value : ids)
+        sum += value.low();
+    BOOST_CHECK_EQUAL(sum, 500 * 500);
+}
@@ -26,11 +26,18 @@
 #include <boost/functional/hash.hpp>
 #include <boost/unordered_map.hpp>
 #include <iostream>
+#include <servus/serializableUint128.h>
 #include <servus/uint128_t.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <mutex>
 #include <random>
 #include <thread>
+#include <type_traits>
+#include <unordered_set>
 const size_t N_THREADS = 10;
 
 const size_t N_UUIDS = 10000;
@@ -167,14 +174,14 @@ BOOST_AUTO_TEST_CASE(concurrent)
     const auto startTime = std::chrono::system_clock::now();
 
     for (size_t i = 0; i < N_THREADS; ++i)
-        threads[i] = std::thread(std::bind(&Thread::run, maps[i]));
+        threads[i] = std::thread(std::bind(&Thread::run, &maps[i]));
     for (size_t i = 0; i < N_THREADS; ++i)
         threads[i].join();
 
     const std::chrono::duration<double> elapsed =
         std::chrono::system_clock::now() - startTime;
 
-    std::cerr << N_UUIDS * N_THREADS / elapsed.count()
+    std::cerr << N_UUIDS * N_THREADS / elapsed.count() / 1000
               << " UUID generations and hash ops / ms" << std::endl;
 
     TestHash& first = maps[0].hash;
@@ -245,3 +252,318 @@ BOOST_AUTO_TEST_CASE(increment)
     BOOST_CHECK_EQUAL(test128.high(), 0);
     BOOST_CHECK_EQUAL(test128.low(), std::numeric_limits<uint64_t>::max());
 }
+
+BOOST_AUTO_TEST_CASE(arithmetic)
+{
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    const servus::uint128_t one(0, 1);
+    const servus::uint128_t allOnes(max, max);
+
+    BOOST_CHECK_EQUAL(allOnes + one, servus::uint128_t());
+    BOOST_CHECK_EQUAL(servus::uint128_t() - one, allOnes);
+    BOOST_CHECK_EQUAL(servus::uint128_t(1, 0) - one, servus::uint128_t(0, max));
+    BOOST_CHECK_EQUAL(~allOnes, servus::uint128_t());
+    BOOST_CHECK_EQUAL(allOnes ^ servus::uint128_t(max, 0),
+                      servus::uint128_t(0, max));
+
+    BOOST_CHECK_EQUAL(one << 64, servus::uint128_t(1, 0));
+    BOOST_CHECK_EQUAL(one << 127, servus::uint128_t(1ull << 63, 0));
+    BOOST_CHECK_EQUAL(one << 128, servus::uint128_t());
+    BOOST_CHECK_EQUAL(allOnes >> 68, servus::uint128_t(0, max >> 4));
+    BOOST_CHECK_EQUAL(allOnes >> 0, allOnes);
+    BOOST_CHECK_EQUAL(servus::uint128_t(0x12, 0x3400000000000000ull) << 4,
+                      servus::uint128_t(0x123, 0x4000000000000000ull));
+
+    // 2^64 - 1 squared is 2^128 - 2^65 + 1
+    const servus::uint128_t low(0, max);
+    BOOST_CHECK_EQUAL(low * low, servus::uint128_t(max - 1, 1));
+    BOOST_CHECK_EQUAL(allOnes * allOnes, one);
+
+    const servus::uint128_t ten(0, 10);
+    const servus::uint128_t big(0x0123456789abcdefull, 0xfedcba9876543210ull);
+    BOOST_CHECK_EQUAL((big * ten) / ten, big);
+    BOOST_CHECK_EQUAL(big % servus::uint128_t(1, 0),
+                      servus::uint128_t(0, 0xfedcba9876543210ull));
+    BOOST_CHECK_EQUAL(big / servus::uint128_t(1, 0),
+                      servus::uint128_t(0, 0x0123456789abcdefull));
+    BOOST_CHECK_EQUAL(ten / big, servus::uint128_t());
+    BOOST_CHECK_EQUAL(ten % big, ten);
+
+    // the operators and the portable implementation agree
+    std::mt19937_64 random;
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        const servus::uint128_t a(random() >> (i % 64), random());
+        const servus::uint128_t b(random() >> (i + 30) % 64, random());
+        BOOST_CHECK_EQUAL(a * b, servus::detail::multiply(a, b));
+
+        servus::uint128_t remainder;
+        const servus::uint128_t quotient =
+            servus::detail::divide(a, b, remainder);
+        BOOST_CHECK_EQUAL(quotient, a / b);
+        BOOST_CHECK_EQUAL(remainder, a % b);
+        BOOST_CHECK(remainder < b);
+        BOOST_CHECK_EQUAL(quotient * b + remainder, a);
+    }
+}
+
+namespace
+{
+#if __cplusplus >= 201402L && defined(SERVUS_NATIVE_UINT128)
+constexpr servus::uint128_t _countDown(servus::uint128_t value)
+{
+    servus::uint128_t steps;
+    for (--value; value != servus::uint128_t(1, 0); --value)
+        ++steps;
+    steps += value;
+    steps <<= 1;
+    return steps;
+}
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(constexpr_arithmetic)
+{
+    typedef servus::uint128_t uint128_t;
+    constexpr uint64_t max = std::numeric_limits<uint64_t>::max();
+    constexpr uint128_t allOnes(max, max);
+    static_assert(allOnes + uint128_t(1) == uint128_t(), "constexpr add");
+    static_assert(uint128_t(0, max) + 1 == uint128_t(1, 0), "constexpr add");
+    static_assert(uint128_t() - uint128_t(1) == allOnes, "constexpr subtract");
+    static_assert(uint128_t(1, 0) - 1 == uint128_t(0, max),
+                  "constexpr subtract");
+    static_assert(uint128_t(0, max) * uint128_t(0, max) ==
+                      uint128_t(max - 1, 1),
+                  "constexpr multiply");
+    static_assert(allOnes * allOnes == uint128_t(1), "constexpr multiply");
+    static_assert((uint128_t(1) << 127) == uint128_t(1ull << 63, 0),
+                  "constexpr shift");
+    static_assert((allOnes >> 68) == uint128_t(0, max >> 4), "constexpr shift");
+    static_assert((uint128_t(0x12, 0x34) << 0) == uint128_t(0x12, 0x34),
+                  "constexpr shift");
+    static_assert((allOnes & uint128_t(1, 2)) == uint128_t(1, 2) &&
+                      (uint128_t(1, 0) | uint128_t(2)) == uint128_t(1, 2) &&
+                      (allOnes ^ uint128_t(max, 0)) == uint128_t(0, max),
+                  "constexpr bitwise operators");
+#ifdef SERVUS_NATIVE_UINT128
+    constexpr uint128_t big(0x0123456789abcdefull, 0xfedcba9876543210ull);
+    static_assert(big / uint128_t(1, 0) == uint128_t(0x0123456789abcdefull),
+                  "constexpr divide");
+    static_assert(big % uint128_t(1, 0) == uint128_t(0xfedcba9876543210ull),
+                  "constexpr remainder");
+#endif
+#if __cplusplus >= 201402L && defined(SERVUS_NATIVE_UINT128)
+    static_assert(_countDown(uint128_t(1, 3)) == uint128_t(1, 2) << 1,
+                  "constexpr increment, decrement and assignment");
+#endif
+    BOOST_CHECK_EQUAL(allOnes + uint128_t(1), uint128_t());
+}
+
+BOOST_AUTO_TEST_CASE(value_type)
+{
+    static_assert(sizeof(servus::uint128_t) == 16, "no padding or vtable");
+    static_assert(std::is_trivially_copyable<servus::uint128_t>::value,
+                  "memcpy-able");
+    static_assert(std::is_standard_layout<servus::uint128_t>::value,
+                  "plain layout");
+
+    constexpr servus::uint128_t key(42, 17);
+    static_assert(key.high() == 42 && key.low() == 17, "constexpr value");
+    static_assert(key != servus::uint128_t(17) && key > servus::uint128_t(17),
+                  "constexpr comparison");
+    static_assert(key.isUUID() && !servus::uint128_t(1).isUUID(),
+                  "constexpr isUUID");
+
+    std::vector<servus::uint128_t> ids(1000);
+    for (size_t i = 0; i < ids.size(); ++i)
+        ids[i] = servus::uint128_t(i, ~i);
+    std::vector<servus::uint128_t> copies(ids.size());
+    ::memcpy(copies.data(), ids.data(), ids.size() * sizeof(servus::uint128_t));
+    BOOST_CHECK(copies == ids);
+
+    std::atomic<servus::uint128_t> atomic(key);
+    BOOST_CHECK_EQUAL(atomic.load(), key);
+    servus::uint128_t expected = key;
+    BOOST_CHECK(atomic.compare_exchange_strong(expected, ids[1]));
+    BOOST_CHECK(!atomic.compare_exchange_strong(expected, ids[2]));
+    BOOST_CHECK_EQUAL(expected, ids[1]);
+    BOOST_CHECK_EQUAL(atomic.exchange(ids[3]), ids[1]);
+    BOOST_CHECK_EQUAL(atomic.load(), ids[3]);
+}
+
+BOOST_AUTO_TEST_CASE(serializable)
+{
+    const servus::uint128_t id(0x0123456789abcdefull, 0xfedcba9876543210ull);
+    servus::SerializableUint128 wrapped(id);
+    BOOST_CHECK_EQUAL(wrapped.get(), id);
+    BOOST_CHECK_EQUAL(wrapped.getTypeName(), "servus::uint128_t");
+    BOOST_CHECK_EQUAL(wrapped.getTypeIdentifier(),
+                      servus::make_uint128("servus::uint128_t"));
+
+    const servus::Serializable::Data data = wrapped.toBinary();
+    BOOST_REQUIRE_EQUAL(data.size, 16);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data.ptr.get());
+    BOOST_CHECK_EQUAL(bytes[0], 0x10);
+    BOOST_CHECK_EQUAL(bytes[15], 0x01);
+
+    servus::SerializableUint128 copy;
+    BOOST_CHECK(copy.fromBinary(data));
+    BOOST_CHECK_EQUAL(copy.get(), id);
+    BOOST_CHECK(!copy.fromBinary(data.ptr.get(), 8));
+
+    const std::string json = wrapped.toJSON();
+    BOOST_CHECK_EQUAL(json, "\"123456789abcdef:fedcba9876543210\"");
+    copy.set(servus::uint128_t());
+    BOOST_CHECK(copy.fromJSON(json));
+    BOOST_CHECK_EQUAL(copy.get(), id);
+    BOOST_CHECK(copy.fromJSON("\"2a\""));
+    BOOST_CHECK_EQUAL(copy.get(), servus::uint128_t(42));
+
+    BOOST_CHECK(!copy.fromJSON("42"));
+    BOOST_CHECK(!copy.fromJSON("\"\""));
+    BOOST_CHECK(!copy.fromJSON("\"xyz\""));
+    BOOST_CHECK(!copy.fromJSON("\":1\""));
+    BOOST_CHECK(!copy.fromJSON("\"1:\""));
+    BOOST_CHECK_EQUAL(copy.get(), servus::uint128_t(42));
+}
+
+BOOST_AUTO_TEST_CASE(string_conversion)
+{
+    const servus::uint128_t id(0x0123456789abcdefull, 0xfedcba9876543210ull);
+    char buffer[servus::uint128_t::MAX_CHARS];
+    char* end = id.toChars(buffer, buffer + sizeof(buffer));
+    BOOST_REQUIRE(end);
+    BOOST_CHECK_EQUAL(std::string(buffer, end),
+                      "123456789abcdef:fedcba9876543210");
+    BOOST_CHECK_EQUAL(id.getString(), "123456789abcdef:fedcba9876543210");
+    BOOST_CHECK_EQUAL(id.getShortString(), "123..210");
+    BOOST_CHECK(!id.toChars(buffer, buffer + 31));
+
+    const servus::uint128_t zero;
+    end = zero.toChars(buffer, buffer + 3);
+    BOOST_CHECK_EQUAL(std::string(buffer, end), "0:0");
+    BOOST_CHECK_EQUAL(zero.getShortString(), "00..00");
+
+    std::ostringstream stream;
+    stream << std::dec << servus::uint128_t(42) << ' ' << id << ' ' << 42;
+    BOOST_CHECK_EQUAL(stream.str(),
+                      "2a 123456789abcdef:fedcba9876543210 42");
+
+    servus::uint128_t parsed;
+    const std::string full = "123456789ABCDEF:fedcba9876543210";
+    BOOST_CHECK(parsed.fromChars(full.data(), full.data() + full.size()));
+    BOOST_CHECK_EQUAL(parsed, id);
+
+    const std::string escaped = "2a\\0581";
+    BOOST_CHECK(
+        parsed.fromChars(escaped.data(), escaped.data() + escaped.size()));
+    BOOST_CHECK_EQUAL(parsed, servus::uint128_t(42, 1));
+
+    const std::string low = "ffffffffffffffff";
+    BOOST_CHECK(parsed.fromChars(low.data(), low.data() + low.size()));
+    BOOST_CHECK_EQUAL(parsed, servus::uint128_t(0, ~0ull));
+
+    const struct
+    {
+        const char* string;
+        int32_t result;
+    } errors[] = {
+        {"", servus::uint128_t::Result::EMPTY},
+        {":1", servus::uint128_t::Result::EMPTY},
+        {"1:", servus::uint128_t::Result::EMPTY},
+        {"1g", servus::uint128_t::Result::INVALID_CHARACTER},
+        {"0x1", servus::uint128_t::Result::INVALID_CHARACTER},
+        {"1:2:3", servus::uint128_t::Result::INVALID_CHARACTER},
+        {"1\\05", servus::uint128_t::Result::INVALID_CHARACTER},
+        {"10000000000000000", servus::uint128_t::Result::TOO_LONG},
+        {"1:10000000000000000", servus::uint128_t::Result::TOO_LONG}};
+
+    for (const auto& error : errors)
+    {
+        const std::string string = error.string;
+        const servus::uint128_t::Result result =
+            parsed.fromChars(string.data(), string.data() + string.size());
+        BOOST_CHECK_MESSAGE(result == error.result, string << ": " << result);
+        BOOST_CHECK_EQUAL(parsed, servus::uint128_t(0, ~0ull));
+    }
+
+    // random round trips through all representations
+    std::mt19937_64 random;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        const servus::uint128_t value(random() >> (i % 64),
+                                      random() >> (i / 7 % 64));
+        end = value.toChars(buffer, buffer + sizeof(buffer));
+        BOOST_CHECK(parsed.fromChars(buffer, end));
+        BOOST_CHECK_EQUAL(parsed, value);
+        BOOST_CHECK_EQUAL(servus::uint128_t(value.getString()), value);
+
+        std::ostringstream os;
+        os << value;
+        BOOST_CHECK_EQUAL(servus::uint128_t(os.str()), value);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bulk)
+{
+    const std::vector<servus::uint128_t> uuids = servus::make_UUIDs(1000);
+    BOOST_CHECK_EQUAL(uuids.size(), 1000);
+    std::unordered_set<servus::uint128_t> unique;
+    for (const auto& uuid : uuids)
+    {
+        BOOST_CHECK(uuid.isUUID());
+        unique.insert(uuid);
+    }
+    BOOST_CHECK_EQUAL(unique.size(), uuids.size());
+
+    servus::uint128_t array[4];
+    servus::make_UUIDs(array, array + 3);
+    BOOST_CHECK(array[2].isUUID());
+    BOOST_CHECK(!array[3].isUUID());
+    BOOST_CHECK(servus::make_UUIDs(0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(time_ordered)
+{
+    const uint64_t now =
+        uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count());
+
+    std::vector<servus::uint128_t> uuids(10000);
+    for (auto& uuid : uuids)
+        uuid = servus::make_UUIDv7();
+
+    for (size_t i = 0; i < uuids.size(); ++i)
+    {
+        const servus::uint128_t& uuid = uuids[i];
+        BOOST_CHECK(uuid.isUUID());
+        BOOST_CHECK_EQUAL((uuid.high() >> 12) & 0xf, 7);  // version
+        BOOST_CHECK_EQUAL(uuid.low() >> 62, 2);           // variant
+        if (i > 0)
+            BOOST_CHECK_GT(uuid, uuids[i - 1]);
+    }
+    BOOST_CHECK_GE(uuids.front().high() >> 16, now);
+    BOOST_CHECK_LT(uuids.front().high() >> 16, now + 60000);
+
+    // ids are unique and ordered across threads
+    std::vector<servus::uint128_t> threadUUIDs[N_THREADS];
+    std::thread threads[N_THREADS];
+    for (size_t i = 0; i < N_THREADS; ++i)
+        threads[i] = std::thread([&threadUUIDs, i] {
+            for (size_t j = 0; j < N_UUIDS; ++j)
+                threadUUIDs[i].push_back(servus::make_UUIDv7());
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    std::vector<servus::uint128_t> all;
+    for (const auto& current : threadUUIDs)
+    {
+        BOOST_CHECK(std::is_sorted(current.begin(), current.end()));
+        BOOST_CHECK_GT(current.front(), uuids.back());
+        all.insert(all.end(), current.begin(), current.end());
+    }
+    std::sort(all.begin(), all.end());
+    BOOST_CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
@@ -22,6 +22,11 @@
 
 #include <servus/uri.h>
 
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
 BOOST_AUTO_TEST_CASE(uri_parts)
 {
     const std::string uriStr =
@@ -215,6 +220,34 @@ BOOST_AUTO_TEST_CASE(invalid_uri)
     BOOST_CHECK_THROW(servus::URI skypeCrasher("http://:"), std::exception);
 }
 
+BOOST_AUTO_TEST_CASE(try_parse)
+{
+    servus::URI uri("foo://bar");
+    servus::URI::Result result = servus::URI::tryParse("http://host:80/", uri);
+    BOOST_CHECK(result);
+    BOOST_CHECK_EQUAL(uri.getHost(), "host");
+    BOOST_CHECK_EQUAL(uri.getPort(), 80);
+
+    result = servus::URI::tryParse("bad_schema://", uri);
+    BOOST_CHECK(!result);
+    BOOST_CHECK(result == servus::URI::Result::INVALID_SCHEME);
+    BOOST_CHECK_EQUAL(result.getString(), "invalid scheme");
+    BOOST_CHECK_EQUAL(uri.getHost(), "host"); // unchanged on failure
+
+    const auto code = [&uri](const std::string& input) {
+        return servus::URI::tryParse(input, uri).getCode();
+    };
+    BOOST_CHECK(code("8ad-schema://") == servus::URI::Result::INVALID_SCHEME);
+    BOOST_CHECK(code("http://user@:80") == servus::URI::Result::EMPTY_HOST);
+    BOOST_CHECK(code("http://:") == servus::URI::Result::EMPTY_HOST);
+    BOOST_CHECK(code("http://host:port") == servus::URI::Result::INVALID_PORT);
+    BOOST_CHECK(code("http://host:") == servus::URI::Result::INVALID_PORT);
+    BOOST_CHECK(code("http://host:65536") == servus::URI::Result::INVALID_PORT);
+
+    BOOST_CHECK(servus::URI::tryParse("", uri));
+    BOOST_CHECK(uri == servus::URI());
+}
+
 BOOST_AUTO_TEST_CASE(corner_cases)
 {
     servus::URI uri1("path/foo:bar");
@@ -304,3 +337,317 @@ BOOST_AUTO_TEST_CASE(query_without_value)
     BOOST_CHECK(uri.findQuery("foo")->second.empty());
     BOOST_CHECK(uri.findQuery("blubb")->second.empty());
 }
+
+BOOST_AUTO_TEST_CASE(uri_view)
+{
+    const std::string uriStr =
+        "HTTP://bob@www.example.com:8080/path/?key=value&foo=bar#fragment";
+    const servus::URIView view(uriStr);
+    BOOST_REQUIRE(view.isValid());
+    BOOST_CHECK_EQUAL(view.getScheme().str(), "HTTP");
+    BOOST_CHECK(view.getHost() == "www.example.com");
+    BOOST_CHECK(view.getUserinfo() == "bob");
+    BOOST_CHECK_EQUAL(view.getPort(), 8080);
+    BOOST_CHECK(view.getPath() == "/path/");
+    BOOST_CHECK(view.getQuery() == "key=value&foo=bar");
+    BOOST_CHECK(view.getFragment() == "fragment");
+    BOOST_CHECK(view.getHost().data() == uriStr.data() + 11);
+
+    const servus::URI uri(view);
+    BOOST_CHECK(uri == servus::URI(uriStr));
+    BOOST_CHECK_EQUAL(uri.getScheme(), "http");
+    BOOST_CHECK_EQUAL(uri.findQuery("foo")->second, "bar");
+
+    const servus::URIView empty;
+    BOOST_CHECK(empty.isValid());
+    BOOST_CHECK(empty.getPath().empty());
+
+    const char* file = "file://bla.txt?foo";
+    const servus::URIView fileView(file, 14);
+    BOOST_CHECK(fileView.getHost().empty());
+    BOOST_CHECK(fileView.getPath() == "bla.txt");
+    BOOST_CHECK(fileView.getQuery().empty());
+
+    BOOST_CHECK(!servus::URIView("http://host:port").isValid());
+    BOOST_CHECK(!servus::URIView("http://host:65536").isValid());
+    BOOST_CHECK(!servus::URIView("8ad-schema://").isValid());
+    BOOST_CHECK(servus::URIView("http://host:port").getResult() ==
+                servus::URI::Result::INVALID_PORT);
+    BOOST_CHECK_THROW(servus::URI(servus::URIView("http://:")),
+                      std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(parse_benchmark)
+{
+    std::vector<std::string> uris;
+    for (size_t i = 0; i < 1000; ++i)
+        uris.push_back("tcp://zeroeq@host" + std::to_string(i) +
+                       ".example.com:" + std::to_string(1024 + i) +
+                       "/topic/path?session=" + std::to_string(i) +
+                       "&user=foo&schema=bar&compressor=lz4#event");
+    const size_t nRounds = 100;
+    size_t size = 0;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nRounds; ++i)
+        for (const auto& uri : uris)
+            size += servus::URIView(uri).getHost().size();
+    const std::chrono::duration<double> viewTime =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nRounds; ++i)
+        for (const auto& uri : uris)
+            size -= servus::URI(uri).getHost().size();
+    const std::chrono::duration<double> uriTime =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    const double nURIs = nRounds * uris.size();
+    std::cerr << nURIs / viewTime.count() << " URIView/s, "
+              << nURIs / uriTime.count() << " URI/s" << std::endl;
+    BOOST_CHECK_EQUAL(size, 0);
+}
+
+BOOST_AUTO_TEST_CASE(query_order)
+{
+    servus::URI uri("foo://host?b=1&a=2&b=3&&c");
+    servus::URI::ConstKVIter i = uri.queryBegin();
+    BOOST_REQUIRE(i != uri.queryEnd());
+    BOOST_CHECK_EQUAL(i->first, "b");
+    BOOST_CHECK_EQUAL(i->second, "1");
+    ++i;
+    BOOST_CHECK_EQUAL(i->first, "a");
+    ++i;
+    BOOST_CHECK_EQUAL(i->first, "b");
+    BOOST_CHECK_EQUAL(i->second, "3");
+    ++i;
+    BOOST_CHECK_EQUAL(i->first, "c");
+    BOOST_CHECK(++i == uri.queryEnd());
+
+    // the last value of a repeated key wins
+    BOOST_CHECK_EQUAL(uri.findQuery("b")->second, "3");
+
+    uri.addQuery("a", "4");
+    BOOST_CHECK_EQUAL(uri.getQuery(), "b=1&a=2&b=3&&c&a=4");
+    BOOST_CHECK_EQUAL(uri.findQuery("a")->second, "4");
+    BOOST_CHECK_EQUAL(std::distance(uri.queryBegin(), uri.queryEnd()), 5);
+
+    // encoded and plain spellings are the same key
+    uri.setQuery("k%20y=1&x=2&k y=3");
+    BOOST_CHECK_EQUAL(uri.findQuery("k y")->second, "3");
+
+    std::string query;
+    for (size_t j = 0; j < 100; ++j)
+        query += "key" + std::to_string(j % 50) + '=' + std::to_string(j) + '&';
+    uri.setQuery(query);
+    for (size_t j = 0; j < 50; ++j)
+        BOOST_CHECK_EQUAL(uri.findQuery("key" + std::to_string(j))->second,
+                          std::to_string(j + 50));
+    BOOST_CHECK(uri.findQuery("key50") == uri.queryEnd());
+
+    // the index is copied and moved with the URI
+    const servus::URI copied(uri);
+    BOOST_CHECK_EQUAL(copied.findQuery("key7")->second, "57");
+    servus::URI moved(std::move(uri));
+    BOOST_CHECK_EQUAL(moved.findQuery("key7")->second, "57");
+    BOOST_CHECK(uri.findQuery("key7") == uri.queryEnd());
+    BOOST_CHECK_EQUAL(moved.getString(), copied.getString());
+}
+
+BOOST_AUTO_TEST_CASE(part_strings)
+{
+    const servus::URI uri("http://host:8080/path");
+    BOOST_CHECK_EQUAL(uri.getHost().length(), 4);
+    BOOST_CHECK_EQUAL("//" + uri.getHost(), "//host");
+    BOOST_CHECK_EQUAL(uri.getHost() + ":8080", "host:8080");
+    BOOST_CHECK_EQUAL(std::string("/") + uri.getPath(), "//path");
+    BOOST_CHECK_EQUAL(uri.getScheme() + std::string("s"), "https");
+
+    const std::string path = uri.getPath();
+    BOOST_CHECK_EQUAL(::strcmp(path.c_str(), "/path"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(copy_move)
+{
+    const std::string uriStr =
+        "http://bob@www.example.com:8080/path/?key=value&foo=bar#fragment";
+    servus::URI uri(uriStr);
+
+    servus::URI copy(uri);
+    BOOST_CHECK(copy == uri);
+    BOOST_CHECK(copy.getHost().data() != uri.getHost().data());
+
+    const char* host = uri.getHost().data();
+    servus::URI moved(std::move(uri));
+    BOOST_CHECK(moved == copy);
+    BOOST_CHECK_EQUAL(std::to_string(moved), uriStr);
+    BOOST_CHECK(moved.getHost().data() == host); // no reallocation
+    BOOST_CHECK(uri == servus::URI());
+
+    uri = std::move(moved);
+    BOOST_CHECK(uri == copy);
+    BOOST_CHECK(moved == servus::URI());
+    moved = uri;
+    BOOST_CHECK(moved == copy);
+
+    std::vector<servus::URI> uris(100, copy);
+    uris.emplace_back("foo://bar");
+    BOOST_CHECK(uris.front() == copy);
+    BOOST_CHECK_EQUAL(uris.back().getHost(), "bar");
+
+    // setters update the parts following the modified one
+    uri.setHost("localhost");
+    uri.setUserInfo(std::string());
+    BOOST_CHECK_EQUAL(uri.getScheme(), "http");
+    BOOST_CHECK_EQUAL(uri.getPath(), "/path/");
+    BOOST_CHECK_EQUAL(uri.findQuery("foo")->second, "bar");
+    BOOST_CHECK_EQUAL(std::to_string(uri),
+                      "http://localhost:8080/path/?key=value&foo=bar#fragment");
+}
+
+BOOST_AUTO_TEST_CASE(normalize_hash)
+{
+    const std::string uriStr =
+        "http://Bob@WWW.Example.COM:80/%7efoo/%2fbar?%41=%3d#Frag";
+    servus::URI uri("HTTP" + uriStr.substr(4));
+    BOOST_CHECK_EQUAL(std::to_string(uri), uriStr);
+    uri.normalize();
+    BOOST_CHECK_EQUAL(uri.getString(),
+                      "http://Bob@www.example.com/~foo/%2Fbar?A=%3D#Frag");
+    BOOST_CHECK_EQUAL(uri.getPort(), 0);
+    BOOST_CHECK_EQUAL(uri.getUserinfo(), "Bob");
+
+    servus::URI other("http://Bob@www.example.com/~foo/%2Fbar?A=%3D#Frag");
+    BOOST_CHECK(uri == other);
+    BOOST_CHECK_EQUAL(std::hash<servus::URI>()(uri),
+                      std::hash<servus::URI>()(other));
+    BOOST_CHECK(servus::URI("foo://host") != servus::URI("bar://host"));
+
+    servus::URI custom("https://host:8443");
+    custom.normalize();
+    BOOST_CHECK_EQUAL(custom.getPort(), 8443);
+
+    // the string form and hash follow all modifications
+    other.setPort(8080);
+    BOOST_CHECK_EQUAL(std::to_string(other),
+                      "http://Bob@www.example.com:8080/~foo/%2Fbar?A=%3D#Frag");
+    other.addQuery("b", "c");
+    BOOST_CHECK_EQUAL(other.getString(),
+                      "http://Bob@www.example.com:8080/~foo/%2Fbar?A=%3D&b=c");
+    BOOST_CHECK(other == servus::URI(std::to_string(other)));
+    BOOST_CHECK_EQUAL(other.getHash(),
+                      servus::URI(std::to_string(other)).getHash());
+    BOOST_CHECK_EQUAL(other.getAuthority(), "Bob@www.example.com:8080");
+
+    std::unordered_map<servus::URI, int> map;
+    map[uri] = 42;
+    servus::URI key("http://www.EXAMPLE.com:80/%7Efoo/%2Fbar?A=%3D#Frag");
+    key.setUserInfo("Bob");
+    key.normalize();
+    BOOST_CHECK_EQUAL(map[key], 42);
+    BOOST_CHECK_EQUAL(map.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(percent_encoding)
+{
+    const std::string raw = "a b/c?d&e=f#g%h+i:j@k~l";
+    BOOST_CHECK_EQUAL(servus::URI::encode(raw, servus::URI::COMPONENT_PATH),
+                      "a%20b/c%3Fd&e=f%23g%25h+i:j@k~l");
+    BOOST_CHECK_EQUAL(servus::URI::encode(raw, servus::URI::COMPONENT_QUERY),
+                      "a%20b/c?d%26e%3Df%23g%25h%2Bi:j@k~l");
+    BOOST_CHECK_EQUAL(servus::URI::encode(raw, servus::URI::COMPONENT_HOST),
+                      "a%20b%2Fc%3Fd&e=f%23g%25h+i%3Aj%40k~l");
+    for (int i = servus::URI::COMPONENT_USERINFO;
+         i <= servus::URI::COMPONENT_FRAGMENT; ++i)
+    {
+        const auto component = servus::URI::Component(i);
+        BOOST_CHECK_EQUAL(servus::URI::decode(
+                              servus::URI::encode(raw, component)),
+                          raw);
+    }
+    BOOST_CHECK_EQUAL(servus::URI::decode("%41%2f%2F%zz%4"), "A//%zz%4");
+    BOOST_CHECK_EQUAL(servus::URI::decode(std::string("%00", 3)),
+                      std::string(1, '\0'));
+
+    servus::URI uri("http://b%40b@host/my%20dir/file%2Ename?k%20y=v%26l#f%3F");
+    BOOST_CHECK_EQUAL(uri.getPath(), "/my%20dir/file%2Ename");
+    BOOST_CHECK_EQUAL(uri.getDecodedPath(), "/my dir/file.name");
+    BOOST_CHECK_EQUAL(uri.getDecodedUserinfo(), "b@b");
+    BOOST_CHECK_EQUAL(uri.getDecodedFragment(), "f?");
+    BOOST_REQUIRE(uri.findQuery("k y") != uri.queryEnd());
+    BOOST_CHECK_EQUAL(uri.findQuery("k y")->second, "v%26l");
+    BOOST_CHECK_EQUAL(servus::URI::decode(uri.findQuery("k y")->second),
+                      "v&l");
+
+    uri.addQuery("a&b", "c=d e");
+    BOOST_CHECK_EQUAL(uri.getQuery(), "k%20y=v%26l&a%26b=c%3Dd%20e");
+    BOOST_REQUIRE(uri.findQuery("a&b") != uri.queryEnd());
+    BOOST_CHECK_EQUAL(servus::URI::decode(uri.findQuery("a&b")->second),
+                      "c=d e");
+}
+
+BOOST_AUTO_TEST_CASE(ipv6)
+{
+    const servus::URI uri("tcp://[fe80::1%eth0]:4242/path");
+    BOOST_CHECK_EQUAL(uri.getHost(), "fe80::1%eth0");
+    BOOST_CHECK_EQUAL(uri.getPort(), 4242);
+    BOOST_CHECK_EQUAL(uri.getPath(), "/path");
+    BOOST_CHECK_EQUAL(uri.getZoneID(), "eth0");
+    BOOST_CHECK_EQUAL(uri.getAuthority(), "[fe80::1%eth0]:4242");
+    BOOST_CHECK_EQUAL(std::to_string(uri), "tcp://[fe80::1%eth0]:4242/path");
+    BOOST_CHECK(uri == servus::URI(std::to_string(uri)));
+
+    const servus::URI::Address& address = uri.getAddress();
+    BOOST_CHECK_EQUAL(address.family, servus::URI::Address::IPV6);
+    const uint8_t linkLocal[16] = {0xfe, 0x80, 0, 0, 0, 0, 0, 0,
+                                   0,    0,    0, 0, 0, 0, 0, 1};
+    BOOST_CHECK(std::equal(linkLocal, linkLocal + 16, address.bytes));
+
+    const servus::URI encodedZone("tcp://user@[FE80::1%25en0]");
+    BOOST_CHECK_EQUAL(encodedZone.getHost(), "FE80::1%25en0");
+    BOOST_CHECK_EQUAL(encodedZone.getZoneID(), "en0");
+    BOOST_CHECK_EQUAL(encodedZone.getUserinfo(), "user");
+    BOOST_CHECK_EQUAL(encodedZone.getPort(), 0);
+
+    const servus::URI mapped("http://[::ffff:192.168.0.1]:80");
+    const uint8_t ipv4Mapped[16] = {0, 0, 0, 0, 0,    0,    0,   0,
+                                    0, 0, 0xff, 0xff, 192, 168, 0, 1};
+    BOOST_CHECK(std::equal(ipv4Mapped, ipv4Mapped + 16,
+                           mapped.getAddress().bytes));
+    BOOST_CHECK(mapped.getZoneID().empty());
+
+    const servus::URI ipv4("http://10.0.0.255:80");
+    BOOST_CHECK_EQUAL(ipv4.getAddress().family, servus::URI::Address::IPV4);
+    const uint8_t privateIPv4[4] = {10, 0, 0, 255};
+    BOOST_CHECK(std::equal(privateIPv4, privateIPv4 + 4,
+                           ipv4.getAddress().bytes));
+    BOOST_CHECK_EQUAL(servus::URI("http://10.0.0.256").getAddress().family,
+                      servus::URI::Address::NONE);
+    BOOST_CHECK_EQUAL(servus::URI("http://host").getAddress().family,
+                      servus::URI::Address::NONE);
+
+    servus::URI uri2;
+    BOOST_CHECK(servus::URI::tryParse("tcp://[::]", uri2));
+    BOOST_CHECK_EQUAL(uri2.getAddress().family, servus::URI::Address::IPV6);
+    uri2.setHost("[::1]");
+    BOOST_CHECK_EQUAL(uri2.getHost(), "::1");
+    BOOST_CHECK_EQUAL(std::to_string(uri2), "tcp://[::1]");
+    BOOST_CHECK_EQUAL(uri2.getAddress().bytes[15], 1);
+
+    const auto code = [&uri2](const std::string& input) {
+        return servus::URI::tryParse(input, uri2).getCode();
+    };
+    BOOST_CHECK(code("tcp://[fe80::1") == servus::URI::Result::INVALID_HOST);
+    BOOST_CHECK(code("tcp://[::1]x") == servus::URI::Result::INVALID_HOST);
+    BOOST_CHECK(code("tcp://[1::2::3]") == servus::URI::Result::INVALID_HOST);
+    BOOST_CHECK(code("tcp://[1:2:3:4:5:6:7:8:9]") ==
+                servus::URI::Result::INVALID_HOST);
+    BOOST_CHECK(code("tcp://[12345::]") == servus::URI::Result::INVALID_HOST);
+    BOOST_CHECK(code("tcp://[fe80::1%]") == servus::URI::Result::INVALID_HOST);
+    BOOST_CHECK(code("tcp://[host]") == servus::URI::Result::INVALID_HOST);
+    BOOST_CHECK(code("tcp://[::1]:") == servus::URI::Result::INVALID_PORT);
+    BOOST_CHECK(code("tcp://[1:2:3:4:5:6:7:8]:1") ==
+                servus::URI::Result::SUCCESS);
+    BOOST_CHECK(code("tcp://[1:2:3:4:5:6:1.2.3.4]") ==
+                servus::URI::Result::SUCCESS);
+}